@@ -0,0 +1,341 @@
+#include <string>
+#include <vector>
+
+#include "benchutils.h"
+#include "../lib/BBDocument.h"
+#include "../lib/bbcpputils.h"
+#include "../lib/bbcpp_c.h"
+
+using namespace bbcpp;
+using namespace bbcpp::bench;
+
+namespace
+{
+
+// Where each parse phase starts in a corpus, found with one tokenizer pass
+// outside the timed loops so every phase can be measured on its own
+struct PhasePositions
+{
+    std::vector<const char*> text;
+    std::vector<const char*> elements;
+    std::vector<const char*> keyValuePairs;
+};
+
+PhasePositions findPhases(const std::string& corpus)
+{
+    PhasePositions positions;
+
+    BBTokenizer tokenizer(corpus);
+    BBToken token;
+
+    while (tokenizer.next(token))
+    {
+        if (token.source.front() != '[')
+        {
+            positions.text.push_back(token.source.data());
+            continue;
+        }
+
+        positions.elements.push_back(token.source.data());
+
+        if (token.hasParameter())
+        {
+            // [color=red] is parsed from the name, [style color=red] after it
+            const auto nameEnd = token.name.data() + token.name.size();
+            positions.keyValuePairs.push_back(*nameEnd == '=' ? token.name.data() : nameEnd);
+        }
+    }
+
+    return positions;
+}
+
+void BM_ParseText(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+    const auto end = corpus.data() + corpus.size();
+    const auto positions = findPhases(corpus).text;
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        BBToken token;
+        for (auto position : positions)
+        {
+            benchmark::DoNotOptimize(BBTokenizer::parseText(position, end, token));
+        }
+    }
+
+    allocations.report(state, corpus.size(), positions.size());
+}
+
+void BM_ParseElement(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+    const auto end = corpus.data() + corpus.size();
+    const auto positions = findPhases(corpus).elements;
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        BBToken token;
+        for (auto position : positions)
+        {
+            benchmark::DoNotOptimize(BBTokenizer::parseElement(position, end, token));
+        }
+    }
+
+    allocations.report(state, corpus.size(), positions.size());
+}
+
+void BM_ParseKeyValuePairs(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+    const auto end = corpus.data() + corpus.size();
+    const auto positions = findPhases(corpus).keyValuePairs;
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        BBToken token;
+        for (auto position : positions)
+        {
+            benchmark::DoNotOptimize(BBTokenizer::parseKeyValuePairs(position, end, token));
+        }
+    }
+
+    allocations.report(state, corpus.size(), positions.size());
+}
+
+void BM_Tokenize(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+
+    AllocationCounter allocations;
+    std::size_t tokens = 0;
+    for (auto _ : state)
+    {
+        BBTokenizer tokenizer(corpus);
+        BBToken token;
+
+        tokens = 0;
+        while (tokenizer.next(token))
+        {
+            tokens++;
+        }
+        benchmark::DoNotOptimize(tokens);
+    }
+
+    allocations.report(state, corpus.size(), tokens);
+}
+
+void BM_Load(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+
+    const auto nodes = countNodes(corpus);
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        auto doc = BBDocument::create();
+        doc->load(corpus);
+        benchmark::DoNotOptimize(doc);
+    }
+
+    allocations.report(state, corpus.size(), nodes);
+}
+
+// One keystroke typed and then deleted at `position` (a fraction of the
+// corpus size), the update a live preview makes instead of a full load()
+void BM_ApplyEdit(benchmark::State& state, const char* corpusName, double position)
+{
+    const auto& corpus = loadCorpus(corpusName);
+    auto doc = BBDocument::create();
+    doc->load(corpus);
+
+    const auto offset = static_cast<std::size_t>(corpus.size() * position);
+    const auto nodes = countNodes(corpus);
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        doc->applyEdit(offset, 0, "x");
+        doc->applyEdit(offset, 1, "");
+    }
+
+    allocations.report(state, corpus.size(), nodes);
+}
+
+void BM_LoadWithMetrics(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+
+    const auto nodes = countNodes(corpus);
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        ParseMetrics metrics;
+        auto doc = BBDocument::create();
+        doc->load(corpus, metrics);
+        benchmark::DoNotOptimize(doc);
+        benchmark::DoNotOptimize(metrics);
+    }
+
+    allocations.report(state, corpus.size(), nodes);
+}
+
+void BM_LoadWithTrace(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+
+    const auto nodes = countNodes(corpus);
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        NullParseMetrics metrics;
+        ParseTrace trace(0);
+        auto doc = BBDocument::create();
+        doc->load(corpus, metrics, trace);
+        benchmark::DoNotOptimize(doc);
+        benchmark::DoNotOptimize(trace);
+    }
+
+    allocations.report(state, corpus.size(), nodes);
+}
+
+void BM_GetRawString(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+    auto doc = BBDocument::create();
+    doc->load(corpus);
+
+    const auto nodes = countNodes(corpus);
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(getRawString(*doc));
+    }
+
+    allocations.report(state, corpus.size(), nodes);
+}
+
+std::size_t walkNode(bbcpp_node_handle node)
+{
+    std::size_t visited = 1;
+
+    bbcpp_node_type type;
+    bbcpp_node_get_type(node, &type);
+
+    if (type == BBCPP_NODE_TEXT)
+    {
+        char buffer[1];
+        size_t length = 0;
+        bbcpp_text_get_content(node, buffer, 0, &length);
+        benchmark::DoNotOptimize(length);
+    }
+
+    size_t count = 0;
+    bbcpp_node_get_children_count(node, &count);
+    for (size_t i = 0; i < count; i++)
+    {
+        bbcpp_node_handle child;
+        if (bbcpp_node_get_child(node, i, &child) == BBCPP_SUCCESS)
+        {
+            visited += walkNode(child);
+            bbcpp_node_destroy(child);
+        }
+    }
+
+    return visited;
+}
+
+void BM_CApiWalk(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+    auto doc = bbcpp_document_create();
+    bbcpp_document_load(doc, corpus.c_str());
+
+    const auto nodes = countNodes(corpus);
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        std::size_t visited = 0;
+
+        size_t count = 0;
+        bbcpp_document_get_children_count(doc, &count);
+        for (size_t i = 0; i < count; i++)
+        {
+            bbcpp_node_handle child;
+            if (bbcpp_document_get_child(doc, i, &child) == BBCPP_SUCCESS)
+            {
+                visited += walkNode(child);
+                bbcpp_node_destroy(child);
+            }
+        }
+
+        benchmark::DoNotOptimize(visited);
+    }
+
+    allocations.report(state, corpus.size(), nodes);
+    bbcpp_document_destroy(doc);
+}
+
+bbcpp_visit_result countVisit(bbcpp_node_handle node, bbcpp_visit_event event, size_t, void* user_data)
+{
+    if (event == BBCPP_VISIT_ENTER)
+    {
+        const char* text = nullptr;
+        size_t length = 0;
+        bbcpp_text_get_view(node, &text, &length);
+        benchmark::DoNotOptimize(length);
+        ++*static_cast<std::size_t*>(user_data);
+    }
+    return BBCPP_VISIT_CONTINUE;
+}
+
+void BM_CApiTraverse(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+    auto doc = bbcpp_document_create();
+    bbcpp_document_load(doc, corpus.c_str());
+
+    const auto nodes = countNodes(corpus);
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        std::size_t visited = 0;
+        bbcpp_document_traverse(doc, countVisit, &visited);
+        benchmark::DoNotOptimize(visited);
+    }
+
+    allocations.report(state, corpus.size(), nodes);
+    bbcpp_document_destroy(doc);
+}
+
+const bool registered = []()
+{
+    for (auto name = CorpusNames; *name != nullptr; name++)
+    {
+        const std::string suffix = std::string("/") + *name;
+        benchmark::RegisterBenchmark(("BM_ParseText" + suffix).c_str(), BM_ParseText, *name);
+        benchmark::RegisterBenchmark(("BM_ParseElement" + suffix).c_str(), BM_ParseElement, *name);
+        benchmark::RegisterBenchmark(("BM_ParseKeyValuePairs" + suffix).c_str(), BM_ParseKeyValuePairs, *name);
+        benchmark::RegisterBenchmark(("BM_Tokenize" + suffix).c_str(), BM_Tokenize, *name);
+        benchmark::RegisterBenchmark(("BM_Load" + suffix).c_str(), BM_Load, *name);
+        benchmark::RegisterBenchmark(("BM_ApplyEdit/middle" + suffix).c_str(), BM_ApplyEdit, *name, 0.5);
+        benchmark::RegisterBenchmark(("BM_ApplyEdit/end" + suffix).c_str(), BM_ApplyEdit, *name, 1.0);
+        benchmark::RegisterBenchmark(("BM_LoadWithMetrics" + suffix).c_str(), BM_LoadWithMetrics, *name);
+        benchmark::RegisterBenchmark(("BM_LoadWithTrace" + suffix).c_str(), BM_LoadWithTrace, *name);
+        benchmark::RegisterBenchmark(("BM_GetRawString" + suffix).c_str(), BM_GetRawString, *name);
+        benchmark::RegisterBenchmark(("BM_CApiWalk" + suffix).c_str(), BM_CApiWalk, *name);
+        benchmark::RegisterBenchmark(("BM_CApiTraverse" + suffix).c_str(), BM_CApiTraverse, *name);
+    }
+    return true;
+}();
+
+} // namespace
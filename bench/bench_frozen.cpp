@@ -0,0 +1,166 @@
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "benchutils.h"
+#include "../lib/BBDocument.h"
+#include "../lib/BBFrozenDocument.h"
+
+using namespace bbcpp;
+using namespace bbcpp::bench;
+
+namespace
+{
+
+// One parsed document and its frozen copy per corpus, shared by every
+// thread of a run so the threads really read the same memory
+struct SharedDocument
+{
+    BBDocumentPtr       tree;
+    BBFrozenDocumentPtr frozen;
+    std::size_t         nodes;
+};
+
+const SharedDocument& sharedDocument(const std::string& corpusName)
+{
+    static std::mutex mutex;
+    static std::map<std::string, SharedDocument> documents;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = documents.find(corpusName);
+    if (it == documents.end())
+    {
+        const auto& corpus = loadCorpus(corpusName);
+
+        SharedDocument document;
+        document.tree = BBDocument::create();
+        document.tree->load(corpus);
+        document.frozen = document.tree->freeze();
+        document.nodes = document.frozen->size();
+        it = documents.emplace(corpusName, document).first;
+    }
+
+    return it->second;
+}
+
+// The usual way of reading a shared tree: every child visited is a
+// shared_ptr copy, so concurrent readers contend on the reference counts
+std::size_t sumTree(const BBNodePtr& parent)
+{
+    std::size_t length = 0;
+    for (const auto node : parent->getChildren())
+    {
+        if (node->getNodeType() == BBNode::NodeType::TEXT)
+        {
+            length += node->downCast<BBTextPtr>()->getText().size();
+        }
+        else
+        {
+            length += node->getNodeName().size() + sumTree(node);
+        }
+    }
+    return length;
+}
+
+std::size_t sumFrozen(const BBFrozenDocument& doc, BBFrozenDocument::Index parent)
+{
+    std::size_t length = 0;
+    for (auto node = doc.getFirstChild(parent); node != BBFrozenDocument::npos; node = doc.getNextSibling(node))
+    {
+        length += doc.getNodeName(node).size();
+        if (doc.getNodeType(node) == BBNode::NodeType::ELEMENT)
+        {
+            length += sumFrozen(doc, node);
+        }
+    }
+    return length;
+}
+
+void BM_SharedTreeRead(benchmark::State& state, const char* corpusName)
+{
+    const auto& document = sharedDocument(corpusName);
+    const BBNodePtr root = document.tree;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sumTree(root));
+    }
+
+    state.SetItemsProcessed(state.iterations() * document.nodes);
+}
+
+void BM_FrozenRead(benchmark::State& state, const char* corpusName)
+{
+    const auto& document = sharedDocument(corpusName);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sumFrozen(*document.frozen, 0));
+    }
+
+    state.SetItemsProcessed(state.iterations() * document.nodes);
+}
+
+void BM_Freeze(benchmark::State& state, const char* corpusName)
+{
+    const auto& document = sharedDocument(corpusName);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(document.tree->freeze());
+    }
+
+    state.SetItemsProcessed(state.iterations() * document.nodes);
+}
+
+void BM_Serialize(benchmark::State& state, const char* corpusName)
+{
+    const auto& document = sharedDocument(corpusName);
+
+    std::string buffer;
+    for (auto _ : state)
+    {
+        document.frozen->serialize(buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * document.nodes);
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+
+// The read side of a cache of pre-parsed posts, to set against BM_Load
+void BM_Deserialize(benchmark::State& state, const char* corpusName)
+{
+    const auto& document = sharedDocument(corpusName);
+    const auto buffer = document.frozen->serialize();
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        const auto doc = BBFrozenDocument::deserialize(buffer.data(), buffer.size());
+        benchmark::DoNotOptimize(doc->size());
+    }
+
+    allocations.report(state, loadCorpus(corpusName).size(), document.nodes);
+}
+
+// items/s per thread count shows how reads scale: the frozen walk should
+// grow with the threads while the shared tree flattens out
+const bool registered = []()
+{
+    for (auto name = CorpusNames; *name != nullptr; name++)
+    {
+        const std::string suffix = std::string("/") + *name;
+        benchmark::RegisterBenchmark(("BM_SharedTreeRead" + suffix).c_str(), BM_SharedTreeRead, *name)
+            ->ThreadRange(1, 8)->UseRealTime();
+        benchmark::RegisterBenchmark(("BM_FrozenRead" + suffix).c_str(), BM_FrozenRead, *name)
+            ->ThreadRange(1, 8)->UseRealTime();
+        benchmark::RegisterBenchmark(("BM_Freeze" + suffix).c_str(), BM_Freeze, *name);
+        benchmark::RegisterBenchmark(("BM_Serialize" + suffix).c_str(), BM_Serialize, *name);
+        benchmark::RegisterBenchmark(("BM_Deserialize" + suffix).c_str(), BM_Deserialize, *name);
+    }
+    return true;
+}();
+
+} // namespace
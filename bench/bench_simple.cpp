@@ -0,0 +1,191 @@
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "benchutils.h"
+#include "../lib/BBDocument.h"
+#include "../lib/bbcpp_simple.h"
+
+using namespace bbcpp;
+using namespace bbcpp::bench;
+
+namespace
+{
+
+const bbcpp_tag_replacement Replacements[] =
+{
+    { "b", "<strong>", "</strong>" },
+    { "i", "<em>", "</em>" },
+    { "u", "<u>", "</u>" },
+    { "quote", "<blockquote>", "</blockquote>" },
+    { "code", "<pre>", "</pre>" },
+    { "url", "<a>", "</a>" }
+};
+
+const char* ModerationTags[] =
+{
+    "b", "i", "u", "s", "url", "img", "quote", "code", "color", "size",
+    "font", "list", "email", "spoiler", "video", "youtube", "center", "style", "hr", "table"
+};
+
+constexpr int ModerationTagCount = static_cast<int>(sizeof(ModerationTags) / sizeof(ModerationTags[0]));
+constexpr int MaxUrls = 64;
+
+// One call of a bbcpp_simple_* function over `bbcode`, writing into `output`
+using SimpleCall = std::function<void(const char* bbcode, std::vector<char>& output)>;
+
+void BM_Simple(benchmark::State& state, const char* corpusName, SimpleCall call)
+{
+    const auto& corpus = loadCorpus(corpusName);
+    std::vector<char> output(corpus.size() * 4 + 1);
+
+    const auto nodes = countNodes(corpus);
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        call(corpus.c_str(), output);
+        benchmark::ClobberMemory();
+    }
+
+    allocations.report(state, corpus.size(), nodes);
+}
+
+// The parse-then-walk way of finding links, kept as a baseline for the
+// streaming bbcpp_simple_extract_url_spans
+void collectUrls(const BBNode& parent, std::vector<std::string>& urls)
+{
+    for (const auto& node : parent.getChildren())
+    {
+        if (node->getNodeType() != BBNode::NodeType::ELEMENT)
+        {
+            continue;
+        }
+
+        const auto element = node->downCast<BBElementPtr>();
+        const auto& name = element->getNodeName();
+        if (element->getElementType() == BBElement::VALUE && name == "url")
+        {
+            urls.push_back(element->getValue());
+        }
+        else if (element->getElementType() == BBElement::SIMPLE && (name == "url" || name == "img")
+                 && !element->getChildren().empty()
+                 && element->getChildren().front()->getNodeType() == BBNode::NodeType::TEXT)
+        {
+            urls.push_back(element->getChildren().front()->downCast<BBTextPtr>()->getText());
+        }
+
+        collectUrls(*node, urls);
+    }
+}
+
+void BM_ExtractUrlsTreeWalk(benchmark::State& state, const char* corpusName)
+{
+    const auto& corpus = loadCorpus(corpusName);
+
+    const auto nodes = countNodes(corpus);
+
+    AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        auto doc = BBDocument::create();
+        doc->load(corpus);
+
+        std::vector<std::string> urls;
+        collectUrls(*doc, urls);
+        benchmark::DoNotOptimize(urls);
+    }
+
+    allocations.report(state, corpus.size(), nodes);
+}
+
+const bool registered = []()
+{
+    static bbcpp_replacement_table_handle compiled = bbcpp_simple_compile_replacements(Replacements, 6);
+    static bbcpp_render_cache_handle cache = bbcpp_render_cache_create(64 << 20, 0);
+
+    const std::vector<std::pair<std::string, SimpleCall>> calls =
+    {
+        { "get_text", [](const char* bbcode, std::vector<char>& out)
+            { bbcpp_simple_get_text(bbcode, out.data(), out.size()); } },
+        { "to_html", [](const char* bbcode, std::vector<char>& out)
+            { bbcpp_simple_to_html(bbcode, out.data(), out.size()); } },
+        // every iteration after the first is a cache hit
+        { "get_text_cached", [](const char* bbcode, std::vector<char>& out)
+            { bbcpp_simple_get_text_cached(cache, bbcode, out.data(), out.size()); } },
+        { "to_html_cached", [](const char* bbcode, std::vector<char>& out)
+            { bbcpp_simple_to_html_cached(cache, bbcode, out.data(), out.size()); } },
+        { "has_tag", [](const char* bbcode, std::vector<char>&)
+            { benchmark::DoNotOptimize(bbcpp_simple_has_tag(bbcode, "quote")); } },
+        { "count_tags", [](const char* bbcode, std::vector<char>&)
+            { benchmark::DoNotOptimize(bbcpp_simple_count_tags(bbcode, "b")); } },
+        { "count_tags_multi", [](const char* bbcode, std::vector<char>&)
+            {
+                int counts[ModerationTagCount];
+                bbcpp_simple_count_tags_multi(bbcode, ModerationTags, ModerationTagCount, counts);
+                benchmark::DoNotOptimize(counts);
+            } },
+        { "count_tags_x20", [](const char* bbcode, std::vector<char>&)
+            {
+                // the one-call-per-tag pattern count_tags_multi replaces
+                for (auto name : ModerationTags)
+                {
+                    benchmark::DoNotOptimize(bbcpp_simple_count_tags(bbcode, name));
+                }
+            } },
+        { "extract_urls", [](const char* bbcode, std::vector<char>& out)
+            {
+                auto urls = reinterpret_cast<char (*)[256]>(out.data());
+                bbcpp_simple_extract_urls(bbcode, urls, static_cast<int>(out.size() / 256));
+            } },
+        { "extract_url_spans", [](const char* bbcode, std::vector<char>&)
+            {
+                bbcpp_span spans[MaxUrls];
+                benchmark::DoNotOptimize(bbcpp_simple_extract_url_spans(bbcode, spans, MaxUrls));
+            } },
+        { "extract_quote_authors", [](const char* bbcode, std::vector<char>&)
+            {
+                char authors[16][64];
+                benchmark::DoNotOptimize(bbcpp_simple_extract_quote_authors(bbcode, authors, 16));
+            } },
+        { "validate", [](const char* bbcode, std::vector<char>& out)
+            { benchmark::DoNotOptimize(bbcpp_simple_validate(bbcode, out.data(), out.size())); } },
+        { "validate_ex", [](const char* bbcode, std::vector<char>&)
+            {
+                bbcpp_validation_result result;
+                benchmark::DoNotOptimize(bbcpp_simple_validate_ex(bbcode, &result));
+            } },
+        { "strip_tag", [](const char* bbcode, std::vector<char>& out)
+            { bbcpp_simple_strip_tag(bbcode, "b", out.data(), out.size()); } },
+        { "replace_tags", [](const char* bbcode, std::vector<char>& out)
+            { bbcpp_simple_replace_tags(bbcode, Replacements, 6, out.data(), out.size()); } },
+        { "replace_tags_compiled", [](const char* bbcode, std::vector<char>& out)
+            { bbcpp_simple_replace_tags_compiled(bbcode, compiled, out.data(), out.size()); } },
+        { "get_stats", [](const char* bbcode, std::vector<char>&)
+            {
+                bbcpp_stats stats;
+                benchmark::DoNotOptimize(bbcpp_simple_get_stats(bbcode, &stats));
+            } },
+        { "get_tag_histogram", [](const char* bbcode, std::vector<char>&)
+            {
+                bbcpp_tag_count entries[32];
+                benchmark::DoNotOptimize(bbcpp_simple_get_tag_histogram(bbcode, entries, 32));
+            } }
+    };
+
+    for (auto name = CorpusNames; *name != nullptr; name++)
+    {
+        for (const auto& call : calls)
+        {
+            const auto benchName = "BM_Simple_" + call.first + "/" + *name;
+            benchmark::RegisterBenchmark(benchName.c_str(), BM_Simple, *name, call.second);
+        }
+
+        const auto walkName = std::string("BM_ExtractUrlsTreeWalk/") + *name;
+        benchmark::RegisterBenchmark(walkName.c_str(), BM_ExtractUrlsTreeWalk, *name);
+    }
+
+    return true;
+}();
+
+} // namespace
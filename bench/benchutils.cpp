@@ -0,0 +1,132 @@
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+
+#include "benchutils.h"
+#include "../lib/BBDocument.h"
+#include "BBCorpusGenerator.h"
+
+namespace
+{
+
+std::atomic<std::uint64_t> allocations { 0 };
+
+}
+
+// Every C++ allocation in the benchmark binary goes through these, so the
+// number of allocations per operation can be reported next to the timings
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace bbcpp
+{
+namespace bench
+{
+
+const char* const CorpusNames[] =
+{
+    "forum_posts",
+    "plain_text",
+    "tag_heavy",
+    "parameters",
+    "malformed",
+    "generated_mixed",
+    "generated_deep",
+    "generated_quotes",
+    nullptr
+};
+
+const std::string& loadCorpus(const std::string& name)
+{
+    static std::map<std::string, std::string> corpora;
+
+    auto it = corpora.find(name);
+    if (it != corpora.end())
+    {
+        return it->second;
+    }
+
+    // generated corpora come from a fixed seed so every run sees the same bytes
+    const std::string generatedPrefix = "generated_";
+    if (name.compare(0, generatedPrefix.size(), generatedPrefix) == 0)
+    {
+        auto options = CorpusOptions::preset(name.substr(generatedPrefix.size()));
+        options.seed = 42;
+        options.documents = 32;
+        return corpora.emplace(name, BBCorpusGenerator(options).generateText()).first->second;
+    }
+
+    const std::string filename = std::string(BBCPP_BENCH_CORPUS_DIR) + "/" + name + ".txt";
+    std::ifstream file(filename);
+    if (!file.good())
+    {
+        throw std::runtime_error("Cannot open corpus '" + filename + "'");
+    }
+
+    std::stringstream text;
+    text << file.rdbuf();
+    return corpora.emplace(name, text.str()).first->second;
+}
+
+std::size_t countNodes(const std::string& text)
+{
+    auto doc = BBDocument::create();
+    doc->load(text);
+
+    const auto& stats = doc->getStats();
+    return stats.elementCount + stats.closingCount + stats.textNodeCount;
+}
+
+std::uint64_t allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::report(benchmark::State& state, std::size_t bytes, std::size_t nodes) const
+{
+    const auto allocated = static_cast<double>(allocationCount() - _start);
+    const auto iterations = static_cast<double>(state.iterations());
+
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes));
+    state.counters["nodes/s"] = benchmark::Counter(static_cast<double>(nodes) * iterations, benchmark::Counter::kIsRate);
+    state.counters["allocs/op"] = iterations > 0 ? allocated / iterations : 0.0;
+}
+
+} // namespace bench
+} // namespace bbcpp
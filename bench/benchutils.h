@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+namespace bbcpp
+{
+namespace bench
+{
+
+// Names of the corpora checked in under bench/corpora, followed by the
+// generated_<preset> corpora built by BBCorpusGenerator
+extern const char* const CorpusNames[];
+
+// Loads a corpus once and keeps it for the rest of the run
+const std::string& loadCorpus(const std::string& name);
+
+// Number of nodes BBDocument::load() creates for `text`
+std::size_t countNodes(const std::string& text);
+
+// Number of C++ heap allocations made by this process so far
+std::uint64_t allocationCount();
+
+// Collects the allocations made between construction and report()
+class AllocationCounter
+{
+public:
+    AllocationCounter() : _start(allocationCount()) {}
+
+    // sets bytes/sec, nodes/sec and allocs/op for a run where every iteration
+    // processed `bytes` of input and touched `nodes` nodes
+    void report(benchmark::State& state, std::size_t bytes, std::size_t nodes) const;
+
+private:
+    std::uint64_t _start;
+};
+
+} // namespace bench
+} // namespace bbcpp
@@ -3,11 +3,14 @@
 #include <string.h>
 #include "../lib/bbcpp_c.h"
 
-void print_node_recursive(bbcpp_node_handle node, int depth) {
-    if (!node) return;
+bbcpp_visit_result print_node(bbcpp_node_handle node, bbcpp_visit_event event, size_t depth, void* user_data) {
+    (void)user_data;
+    
+    // Children are printed on their own, nothing to do when leaving a node
+    if (event != BBCPP_VISIT_ENTER) return BBCPP_VISIT_CONTINUE;
     
     // Print indentation
-    for (int i = 0; i < depth; i++) {
+    for (size_t i = 0; i < depth; i++) {
         printf("  ");
     }
     
@@ -15,7 +18,7 @@ void print_node_recursive(bbcpp_node_handle node, int depth) {
     bbcpp_node_type type;
     if (bbcpp_node_get_type(node, &type) != BBCPP_SUCCESS) {
         printf("Error getting node type\n");
-        return;
+        return BBCPP_VISIT_SKIP_CHILDREN;
     }
     
     // Get node name
@@ -24,7 +27,7 @@ void print_node_recursive(bbcpp_node_handle node, int depth) {
     bbcpp_error result = bbcpp_node_get_name(node, name, sizeof(name), &name_length);
     if (result != BBCPP_SUCCESS) {
         printf("Error getting node name: %s\n", bbcpp_error_string(result));
-        return;
+        return BBCPP_VISIT_SKIP_CHILDREN;
     }
     
     switch (type) {
@@ -35,6 +38,13 @@ void print_node_recursive(bbcpp_node_handle node, int depth) {
         case BBCPP_NODE_ELEMENT: {
             printf("[ELEMENT] %s", name);
             
+            // [tag=value] has a value, [tag key=value] parameters
+            char tag_value[128] = {0};
+            size_t tag_value_len;
+            if (bbcpp_element_get_value(node, tag_value, sizeof(tag_value), &tag_value_len) == BBCPP_SUCCESS) {
+                printf(" = %s", tag_value);
+            }
+
             // Check if it has parameters
             size_t param_count;
             if (bbcpp_element_get_parameter_count(node, &param_count) == BBCPP_SUCCESS && param_count > 0) {
@@ -72,18 +82,7 @@ void print_node_recursive(bbcpp_node_handle node, int depth) {
             break;
     }
     
-    // Print children
-    size_t child_count;
-    if (bbcpp_node_get_children_count(node, &child_count) == BBCPP_SUCCESS) {
-        for (size_t i = 0; i < child_count; i++) {
-            bbcpp_node_handle child;
-            if (bbcpp_node_get_child(node, i, &child) == BBCPP_SUCCESS) {
-                print_node_recursive(child, depth + 1);
-                // Note: In a real application, you'd need to track and free these node handles
-                // For this simple example, we're not doing proper cleanup
-            }
-        }
-    }
+    return BBCPP_VISIT_CONTINUE;
 }
 
 int main(int argc, char* argv[]) {
@@ -120,17 +119,11 @@ int main(int argc, char* argv[]) {
     printf("\nManual Tree Walk:\n");
     printf("-----------------\n");
     
-    // Get document as a node and walk the tree
+    // Walk the tree, the traversal keeps its own stack so deep documents are fine
     size_t child_count;
     if (bbcpp_document_get_children_count(doc, &child_count) == BBCPP_SUCCESS) {
         printf("Document has %zu children:\n", child_count);
-        
-        for (size_t i = 0; i < child_count; i++) {
-            bbcpp_node_handle child;
-            if (bbcpp_document_get_child(doc, i, &child) == BBCPP_SUCCESS) {
-                print_node_recursive(child, 0);
-            }
-        }
+        bbcpp_document_traverse(doc, print_node, NULL);
     }
     
     printf("\nRaw Text Extraction:\n");
@@ -146,6 +139,7 @@ int main(int argc, char* argv[]) {
             if (bbcpp_get_raw_string(child, raw_text, sizeof(raw_text), &raw_length) == BBCPP_SUCCESS) {
                 printf("Child %zu raw text: \"%s\"\n", i, raw_text);
             }
+            bbcpp_node_destroy(child);
         }
     }
     
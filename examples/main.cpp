@@ -29,9 +29,11 @@ int main(int argc, char* argv[])
         .show_positional_help();
 
     options.add_options()
-        ("f, file", "File", cxxopts::value<std::string>());
+        ("f, file", "File", cxxopts::value<std::string>())
+        ("t, trace", "Write a Chrome trace of the parse phases to this file", cxxopts::value<std::string>());
 
     std::string inputfile;
+    std::string tracefile;
 
     try
     {
@@ -40,6 +42,10 @@ int main(int argc, char* argv[])
         {
             inputfile = result["file"].as<std::string>();
         }
+        if (result.count("trace") > 0)
+        {
+            tracefile = result["trace"].as<std::string>();
+        }
     }
     catch (const cxxopts::OptionException& e)
     {
@@ -54,8 +60,27 @@ int main(int argc, char* argv[])
         std::cout << "bbcode: " << filetext << std::endl;
 
         auto doc = BBDocument::create();
-        doc->load(filetext);
-        
+        if (tracefile.size() > 0)
+        {
+            ParseMetrics metrics;
+            ParseTrace trace;
+            doc->load(filetext, metrics, trace);
+
+            std::ofstream json(tracefile);
+            trace.writeChromeTrace(json);
+
+            for (auto phase : { ParsePhase::TOKENIZE, ParsePhase::PARAMETERS, ParsePhase::NODES, ParsePhase::FIXUP })
+            {
+                std::cout << parsePhaseName(phase) << ": " << trace.count(phase) << " scopes, "
+                    << std::chrono::duration_cast<std::chrono::microseconds>(trace.total(phase)).count() << "us" << std::endl;
+            }
+            std::cout << "trace: " << tracefile << std::endl;
+        }
+        else
+        {
+            doc->load(filetext);
+        }
+
         printDocument(*doc);
     }
     else
@@ -1,46 +1,371 @@
 #include <cstring>
 #include <cctype>
+#include <algorithm>
+#include <charconv>
 #include "BBDocument.h"
+#include "bbcpputils.h"
 
 namespace bbcpp
 {
 
+namespace
+{
+
+bool hasLimits(const ParseLimits& limits)
+{
+    return limits.maxDepth != ParseLimits::Unlimited
+        || limits.maxNodes != ParseLimits::Unlimited
+        || limits.maxTextLength != ParseLimits::Unlimited
+        || limits.maxParameters != ParseLimits::Unlimited
+        || limits.maxTagNameLength != ParseLimits::Unlimited;
+}
+
+bool isClosing(const BBNode& node)
+{
+    return node.getNodeType() == BBNode::NodeType::ELEMENT
+        && static_cast<const BBElement&>(node).getElementType() == BBElement::CLOSING;
+}
+
+bool isClosed(const BBNode& element)
+{
+    if (element.getNodeType() == BBNode::NodeType::ELEMENT && static_cast<const BBElement&>(element).isVoid())
+    {
+        return true;
+    }
+
+    // a closing tag pops the element it is appended to, so nothing follows it
+    return !element.getChildren().empty() && isClosing(*element.getChildren().back());
+}
+
+}
+
 BBNode::BBNode(NodeType nodeType, const std::string& name)
     : _name(name), _nodeType(nodeType)
 {
     // nothing to do
 }
 
-BBText &BBDocument::newText(const std::string &text)
+BBNode::~BBNode()
+{
+    // Unclosed tags nest every following node one level deeper, so letting
+    // each child free its own children would recurse once per level and
+    // overflow the stack on hostile input. Detach descendants that nobody
+    // else holds and release them from a flat list instead.
+    BBNodeList pending;
+    pending.swap(_children);
+
+    while (!pending.empty())
+    {
+        BBNodePtr node = std::move(pending.back());
+        pending.pop_back();
+
+        if (node.use_count() == 1)
+        {
+            std::move(node->_children.begin(), node->_children.end(), std::back_inserter(pending));
+            node->_children.clear();
+        }
+    }
+}
+
+const char* statusName(BBStatus status)
+{
+    switch (status)
+    {
+        default:
+            return "unknown";
+
+        case BBStatus::OK:
+            return "ok";
+
+        case BBStatus::TRUNCATED:
+            return "truncated";
+
+        case BBStatus::SOURCE_TOO_LARGE:
+            return "source too large";
+
+        case BBStatus::OUT_OF_RANGE:
+            return "out of range";
+
+        case BBStatus::INVALID_FORMAT:
+            return "invalid format";
+    }
+}
+
+const char* parsePhaseName(ParsePhase phase)
+{
+    switch (phase)
+    {
+        default:
+            return "unknown";
+
+        case ParsePhase::TOKENIZE:
+            return "tokenize";
+
+        case ParsePhase::PARAMETERS:
+            return "parameters";
+
+        case ParsePhase::NODES:
+            return "nodes";
+
+        case ParsePhase::FIXUP:
+            return "fixup";
+    }
+}
+
+namespace
+{
+
+std::string_view trimSpaces(std::string_view text)
+{
+    while (!text.empty() && IsSpace(text.front()))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && IsSpace(text.back()))
+    {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+
+    c = FoldCase(c);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+struct NamedColor
+{
+    std::string_view    name;
+    std::uint32_t       rgba;
+};
+
+// the CSS 2.1 names, the ones forum color pickers offer
+constexpr NamedColor NamedColors[] =
+{
+    { "black", 0x000000ff }, { "silver", 0xc0c0c0ff }, { "gray", 0x808080ff }, { "grey", 0x808080ff },
+    { "white", 0xffffffff }, { "maroon", 0x800000ff }, { "red", 0xff0000ff }, { "purple", 0x800080ff },
+    { "fuchsia", 0xff00ffff }, { "magenta", 0xff00ffff }, { "green", 0x008000ff }, { "lime", 0x00ff00ff },
+    { "olive", 0x808000ff }, { "yellow", 0xffff00ff }, { "navy", 0x000080ff }, { "blue", 0x0000ffff },
+    { "teal", 0x008080ff }, { "aqua", 0x00ffffff }, { "cyan", 0x00ffffff }, { "orange", 0xffa500ff },
+    { "pink", 0xffc0cbff }, { "brown", 0xa52a2aff }, { "transparent", 0x00000000 }
+};
+
+}
+
+bool DecodeColor(std::string_view text, std::uint32_t& rgba)
+{
+    text = trimSpaces(text);
+
+    if (!text.empty() && text.front() == '#')
+    {
+        const auto digits = text.substr(1);
+        if (digits.size() != 3 && digits.size() != 4 && digits.size() != 6 && digits.size() != 8)
+        {
+            return false;
+        }
+
+        // #rgb and #rgba repeat each digit, a missing alpha is opaque
+        const auto shortForm = digits.size() <= 4;
+        std::uint32_t value = 0;
+        for (auto c : digits)
+        {
+            const auto digit = hexDigit(c);
+            if (digit < 0)
+            {
+                return false;
+            }
+            value = shortForm ? (value << 8) | static_cast<std::uint32_t>(digit * 0x11) : (value << 4) | static_cast<std::uint32_t>(digit);
+        }
+
+        rgba = digits.size() == 3 || digits.size() == 6 ? (value << 8) | 0xff : value;
+        return true;
+    }
+
+    for (const auto& color : NamedColors)
+    {
+        if (BBTagTable::equals(color.name, text))
+        {
+            rgba = color.rgba;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool DecodeInteger(std::string_view text, std::int64_t& value)
+{
+    text = trimSpaces(text);
+    if (!text.empty() && text.front() == '+')
+    {
+        text.remove_prefix(1);
+    }
+
+    std::int64_t result = 0;
+    const auto end = text.data() + text.size();
+    const auto parsed = std::from_chars(text.data(), end, result);
+    if (text.empty() || parsed.ec != std::errc() || parsed.ptr != end)
+    {
+        return false;
+    }
+
+    value = result;
+    return true;
+}
+
+bool DecodeUrl(std::string_view text, std::string_view& url)
+{
+    text = trimSpaces(text);
+    if (text.empty())
+    {
+        return false;
+    }
+
+    for (auto c : text)
+    {
+        const auto byte = static_cast<unsigned char>(c);
+        if (byte <= ' ' || byte == 0x7f || c == '"' || c == '\'' || c == '<' || c == '>' || c == '\\' || c == '`')
+        {
+            return false;
+        }
+    }
+
+    // a scheme is whatever comes before the first ':' that precedes any path;
+    // relative links and www.example.com have none
+    const auto colon = text.find(':');
+    if (colon != std::string_view::npos && colon < text.find_first_of("/?#"))
+    {
+        const auto scheme = text.substr(0, colon);
+        if (!BBTagTable::equals(scheme, "http") && !BBTagTable::equals(scheme, "https")
+            && !BBTagTable::equals(scheme, "ftp") && !BBTagTable::equals(scheme, "mailto"))
+        {
+            return false;
+        }
+    }
+
+    url = text;
+    return true;
+}
+
+void ParseTrace::writeChromeTrace(std::ostream& os) const
+{
+    const auto origin = _events.empty() ? TimePoint() : _events.front().start;
+    const auto micros = [](Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    };
+
+    os << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < _events.size(); i++)
+    {
+        const auto& event = _events[i];
+        os << (i > 0 ? ",\n" : "\n")
+           << "{\"name\":\"" << parsePhaseName(event.phase) << "\",\"cat\":\"bbcpp\",\"ph\":\"X\""
+           << ",\"ts\":" << micros(event.start - origin)
+           << ",\"dur\":" << micros(event.duration)
+           << ",\"pid\":1,\"tid\":1}";
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedEvents\":" << _dropped << "}}\n";
+}
+
+std::size_t BBTagTable::intern(std::string_view name)
 {
-    // first try to append this text to the item on top of the stack
-    // if that is a BBText object, if not, then see if the last element
-    // pushed to BBDocument is a text item, and if so append this to that
-    // text
-    if (_stack.size() > 0 && _stack.top()->getChildren().size() > 0)
+    auto id = find(name);
+    if (id != npos)
+    {
+        return id;
+    }
+
+    id = _names.size();
+    _names.emplace_back(name);
+    _hashes.push_back(hash(name));
+
+    // keep the load factor at or below one half so probes stay short
+    if (_names.size() * 2 > _slots.size())
     {
-        auto totalChildCnt = _stack.top()->getChildren().size();
-        auto textnode = _stack.top()->getChildren().at(totalChildCnt - 1)->downCast<BBTextPtr>(false);
-        if (textnode)
+        rehash(std::max<std::size_t>(16, _slots.size() * 2));
+    }
+    else
+    {
+        const auto mask = _slots.size() - 1;
+        auto slot = _hashes[id] & mask;
+        while (_slots[slot] != 0)
         {
-            textnode->append(text);
-            return *textnode;
+            slot = (slot + 1) & mask;
         }
+        _slots[slot] = static_cast<std::uint32_t>(id + 1);
     }
-    else if (_children.size() > 0)
+
+    return id;
+}
+
+void BBTagTable::rehash(std::size_t slotCount)
+{
+    _slots.assign(slotCount, 0);
+
+    const auto mask = slotCount - 1;
+    for (std::size_t id = 0; id < _names.size(); id++)
     {
-        auto textnode = _children.back()->downCast<BBTextPtr>(false);
-        if (textnode)
+        auto slot = _hashes[id] & mask;
+        while (_slots[slot] != 0)
         {
-            textnode->append(text);
-            return *textnode;
+            slot = (slot + 1) & mask;
         }
+        _slots[slot] = static_cast<std::uint32_t>(id + 1);
+    }
+}
+
+BBTextPtr BBDocument::mergeTarget() const
+{
+    // text is appended to the last child of the element on top of the
+    // stack, or of the document when nothing is open, if that is a BBText
+    const auto& children = _stack.size() > 0 ? _stack.top()->getChildren() : _children;
+    if (children.size() > 0)
+    {
+        return children.back()->downCast<BBTextPtr>(false);
+    }
+
+    return BBTextPtr();
+}
+
+std::size_t BBDocument::appendSource(const std::string& bbcode)
+{
+    // node offsets are 32 bits
+    if (bbcode.size() > MaxSourceSize - _source.size())
+    {
+        BBCPP_THROW(std::length_error("BBCode source is larger than 4 GB"));
+    }
+
+    const auto offset = _source.size();
+    _source += bbcode;
+    _contentEnd = _sourceEnd = static_cast<std::uint32_t>(_source.size());
+    return offset;
+}
+
+BBText &BBDocument::newText(const std::string &text, std::uint32_t begin, std::uint32_t end)
+{
+    if (auto textnode = mergeTarget())
+    {
+        textnode->append(text);
+        textnode->_contentEnd = textnode->_sourceEnd = end;
+        _stats.textLength += text.size();
+        return *textnode;
     }
 
     // ok, there was no previous text element so we wil either add this text
     // element as a child of the top item OR we'll add it to the BBDocucment
     // object
     auto textNode = std::make_shared<BBText>(text);
+    textNode->_sourceBegin = textNode->_contentBegin = begin;
+    textNode->_contentEnd = textNode->_sourceEnd = end;
+    _stats.textNodeCount++;
+    _stats.textLength += text.size();
     if (_stack.size() > 0)
     {
         _stack.top()->appendChild(textNode);
@@ -54,9 +379,243 @@ BBText &BBDocument::newText(const std::string &text)
     return *textNode;
 }
 
-BBElement& BBDocument::newElement(const std::string &name)
+std::shared_ptr<const BBTagSchema> BBTagSchema::defaults()
+{
+    static const auto schema = []
+    {
+        auto defaults = std::make_shared<BBTagSchema>();
+        defaults->addVoidTag("hr")
+            .addVoidTag("br")
+            .addVoidTag("img", true)
+            .addImplicitClose("*", "*")
+            .addParent("*", "list");
+        return std::shared_ptr<const BBTagSchema>(defaults);
+    }();
+
+    return schema;
+}
+
+BBTagSchema& BBTagSchema::addVoidTag(std::string_view name, bool onlyWithValue)
+{
+    auto& rule = getRule(name);
+    rule.isVoid = !onlyWithValue;
+    rule.voidWithValue = onlyWithValue;
+    return *this;
+}
+
+BBTagSchema& BBTagSchema::addImplicitClose(std::string_view name, std::string_view sibling)
+{
+    getRule(name).closes.emplace_back(sibling);
+    return *this;
+}
+
+BBTagSchema& BBTagSchema::addParent(std::string_view name, std::string_view parent)
 {
-    auto newNode = std::make_shared<BBElement>(name);
+    getRule(name).parents.emplace_back(parent);
+    return *this;
+}
+
+BBTagSchema::Rule& BBTagSchema::getRule(std::string_view name)
+{
+    for (auto& rule : _rules)
+    {
+        if (BBTagTable::equals(rule.name, name))
+        {
+            return rule;
+        }
+    }
+
+    _rules.emplace_back();
+    _rules.back().name = std::string(name);
+    return _rules.back();
+}
+
+const std::vector<BBDocument::TagRule>& BBDocument::resolveRules(const ParseOptions& options)
+{
+    static const ParseOptions defaults;
+    static const auto defaultRules = []
+    {
+        std::vector<TagRule> rules;
+        resolveRules(defaults, [](std::string_view name) { return BBTag::find(name); }, rules);
+        return rules;
+    }();
+
+    if (options.schema == defaults.schema && options.rawTags == defaults.rawTags)
+    {
+        return defaultRules;
+    }
+
+    resolveRules(options, [this](std::string_view name) { return internTag(name); }, _rules);
+    return _rules;
+}
+
+template<typename InternT>
+void BBDocument::resolveRules(const ParseOptions& options, InternT intern, std::vector<TagRule>& rules)
+{
+    rules.clear();
+    const auto ruleFor = [&intern, &rules](std::string_view name) -> TagRule&
+    {
+        const auto id = intern(name);
+        if (rules.size() <= id)
+        {
+            rules.resize(id + 1);
+        }
+        return rules[id];
+    };
+
+    for (const auto& name : options.rawTags)
+    {
+        ruleFor(name).raw = true;
+    }
+
+    if (options.schema)
+    {
+        for (const auto& rule : options.schema->getRules())
+        {
+            std::vector<BBTagId> closes;
+            std::vector<BBTagId> parents;
+            for (const auto& name : rule.closes)
+            {
+                closes.push_back(intern(name));
+            }
+            for (const auto& name : rule.parents)
+            {
+                parents.push_back(intern(name));
+            }
+
+            auto& resolved = ruleFor(rule.name);
+            resolved.isVoid = rule.isVoid;
+            resolved.voidWithValue = rule.voidWithValue;
+            resolved.closes = std::move(closes);
+            resolved.parents = std::move(parents);
+        }
+    }
+}
+
+BBTagId BBDocument::internTag(const BBToken& token)
+{
+    if (token.tagId != BBTag::NONE)
+    {
+        return token.tagId;
+    }
+
+    return static_cast<BBTagId>(BBTag::COUNT + _tags.intern(token.name));
+}
+
+BBTagId BBDocument::internTag(std::string_view name)
+{
+    const auto id = BBTag::find(name);
+    return id != BBTag::NONE ? id : static_cast<BBTagId>(BBTag::COUNT + _tags.intern(name));
+}
+
+BBTagId BBDocument::findOpenTag(const BBToken& token) const
+{
+    auto id = token.tagId;
+    if (id == BBTag::NONE)
+    {
+        const auto index = _tags.find(token.name);
+        if (index == BBTagTable::npos)
+        {
+            return BBTag::NONE;
+        }
+        id = static_cast<BBTagId>(BBTag::COUNT + index);
+    }
+
+    return id < _openCounts.size() && _openCounts[id] > 0 ? id : BBTag::NONE;
+}
+
+void BBDocument::refuseTag(BBTagId id)
+{
+    const auto open = id < _openCounts.size() ? _openCounts[id] : 0;
+    if (!_refused.empty() && _refused.back().tagId == id && _refused.back().depth == _stack.size()
+        && _refused.back().openCount == open)
+    {
+        _refused.back().count++;
+        return;
+    }
+
+    if (_lastRefused.size() <= id)
+    {
+        _lastRefused.resize(id + 1);
+    }
+
+    _refused.push_back({ id, open, _stack.size(), 1, _lastRefused[id] });
+    _lastRefused[id] = _refused.size();
+}
+
+bool BBDocument::closeRefusedTag(const BBToken& token)
+{
+    const auto id = token.tagId != BBTag::NONE ? token.tagId : getTagId(token.name);
+    if (id >= _lastRefused.size() || _lastRefused[id] == 0)
+    {
+        return false;
+    }
+
+    // an element of the same tag opened after it is the closer's match
+    const auto index = _lastRefused[id] - 1;
+    const auto open = id < _openCounts.size() ? _openCounts[id] : 0;
+    if (open != _refused[index].openCount)
+    {
+        return false;
+    }
+
+    // along with the refused tags inside it
+    const auto keep = --_refused[index].count > 0 ? index + 1 : index;
+    while (_refused.size() > keep)
+    {
+        popRefusedTag();
+    }
+
+    return true;
+}
+
+void BBDocument::popRefusedTag()
+{
+    _lastRefused[_refused.back().tagId] = _refused.back().previous;
+    _refused.pop_back();
+}
+
+void BBDocument::pushElement(const BBNodePtr& element)
+{
+    const auto id = static_cast<const BBElement&>(*element).getTagId();
+    if (_openCounts.size() <= id)
+    {
+        _openCounts.resize(id + 1);
+    }
+
+    _openCounts[id]++;
+    _stack.push(element);
+}
+
+void BBDocument::popElement(std::uint32_t contentEnd, std::uint32_t end)
+{
+    auto& element = *_stack.top();
+    element._contentEnd = contentEnd;
+    element._sourceEnd = end;
+
+    _openCounts[static_cast<const BBElement&>(element).getTagId()]--;
+    _stack.pop();
+
+    // tags refused inside the element cannot be closed any more
+    while (!_refused.empty() && _refused.back().depth > _stack.size())
+    {
+        popRefusedTag();
+    }
+}
+
+void BBDocument::clearStack()
+{
+    _stack = BBNodeStack();
+    _openCounts.clear();
+    _refused.clear();
+    _lastRefused.clear();
+}
+
+BBElement& BBDocument::newElement(const std::string &name, BBTagId tagId, std::uint32_t begin, std::uint32_t end)
+{
+    auto newNode = std::make_shared<BBElement>(name, BBElement::SIMPLE, tagId);
+    newNode->_sourceBegin = begin;
+    newNode->_contentBegin = newNode->_contentEnd = newNode->_sourceEnd = end;
     if (_stack.size() > 0)
     {
         _stack.top()->appendChild(newNode);  
@@ -67,29 +626,58 @@ BBElement& BBDocument::newElement(const std::string &name)
         appendChild(newNode);
     }
  
-    _stack.push(newNode);
+    pushElement(newNode);
+    countElement(tagId);
+    return *newNode;
+}
+
+BBElement& BBDocument::newClosingElement(const std::string& name, BBTagId tagId, std::uint32_t begin, std::uint32_t end)
+{
+    auto newNode = std::make_shared<BBElement>(name, BBElement::CLOSING, tagId);
+    newNode->_sourceBegin = begin;
+    newNode->_contentBegin = newNode->_contentEnd = newNode->_sourceEnd = end;
+    _stats.closingCount++;
+
+    // the parser only calls this while an element of the tag is open; the
+    // elements opened after it are closed where this tag starts
+    while (static_cast<const BBElement&>(*_stack.top()).getTagId() != tagId)
+    {
+        popElement(begin, begin);
+    }
+
+    _stack.top()->appendChild(newNode);
+    popElement(begin, end);
     return *newNode;
 }
 
-BBElement& BBDocument::newClosingElement(const std::string& name)
+BBElement& BBDocument::newValueElement(const std::string& name, BBTagId tagId, std::string value,
+    std::uint32_t begin, std::uint32_t end)
 {
-    auto newNode = std::make_shared<BBElement>(name, BBElement::CLOSING);
+    auto newNode = std::make_shared<BBElement>(name, BBElement::VALUE, tagId);
+    newNode->_sourceBegin = begin;
+    newNode->_contentBegin = newNode->_contentEnd = newNode->_sourceEnd = end;
+    newNode->_value = std::move(value);
     if (_stack.size() > 0)
     {
-        _stack.top()->appendChild(newNode);  
-        _stack.pop();
+        _stack.top()->appendChild(newNode);
     }
     else
     {
+        // add this node to the document-node if needed
         appendChild(newNode);
     }
 
+    pushElement(newNode);
+    countElement(tagId);
     return *newNode;
 }
 
-BBElement& BBDocument::newKeyValueElement(const std::string& name, const ParameterMap& pairs)
+BBElement& BBDocument::newKeyValueElement(const std::string& name, BBTagId tagId, const ParameterMap& pairs,
+    std::uint32_t begin, std::uint32_t end)
 {
-    auto newNode = std::make_shared<BBElement>(name, BBElement::PARAMETER);
+    auto newNode = std::make_shared<BBElement>(name, BBElement::PARAMETER, tagId);
+    newNode->_sourceBegin = begin;
+    newNode->_contentBegin = newNode->_contentEnd = newNode->_sourceEnd = end;
     if (_stack.size() > 0)
     {
         _stack.top()->appendChild(newNode);
@@ -105,10 +693,320 @@ BBElement& BBDocument::newKeyValueElement(const std::string& name, const Paramet
         newNode->setOrAddParameter(kv.first, kv.second);
     }
 
-    _stack.push(newNode);
+    pushElement(newNode);
+    countElement(tagId);
     return *newNode;
 }
-  
 
+std::string BBDocument::histogramKey(BBTagId tagId) const
+{
+    std::string key(getTagName(tagId));
+    std::transform(key.begin(), key.end(), key.begin(), FoldCase);
+    return key;
+}
+
+void BBDocument::countElement(BBTagId tagId)
+{
+    _stats.elementCount++;
+    _stats.tagHistogram[histogramKey(tagId)]++;
+
+    if (_depthCounts.size() <= _stack.size())
+    {
+        _depthCounts.resize(_stack.size() + 1);
+    }
+    _depthCounts[_stack.size()]++;
+
+    if (_stack.size() > _stats.maxDepth)
+    {
+        _stats.maxDepth = _stack.size();
+    }
+}
+
+BBStatus BBDocument::tryLoad(const std::string& bbcode, const ParseOptions& options) noexcept
+{
+    if (bbcode.size() > MaxSourceSize - _source.size())
+    {
+        return BBStatus::SOURCE_TOO_LARGE;
+    }
+
+    // the stats keep a truncation from any earlier load
+    const auto truncatedBefore = _stats.truncated;
+    _stats.truncated = false;
+    load(bbcode, options);
+
+    const auto truncated = _stats.truncated;
+    _stats.truncated |= truncatedBefore;
+    return truncated ? BBStatus::TRUNCATED : BBStatus::OK;
+}
+
+BBStatus BBDocument::checkEdit(std::size_t offset, std::size_t removedLength, std::size_t insertedLength) const noexcept
+{
+    if (offset > _source.size() || removedLength > _source.size() - offset)
+    {
+        return BBStatus::OUT_OF_RANGE;
+    }
+
+    if (insertedLength > MaxSourceSize - (_source.size() - removedLength))
+    {
+        return BBStatus::SOURCE_TOO_LARGE;
+    }
+
+    return BBStatus::OK;
+}
+
+BBStatus BBDocument::tryApplyEdit(std::size_t offset, std::size_t removedLength, const std::string& inserted,
+    bool& incremental) noexcept
+{
+    const auto status = checkEdit(offset, removedLength, inserted.size());
+    if (status == BBStatus::OK)
+    {
+        incremental = applyEdit(offset, removedLength, inserted);
+    }
+
+    return status;
+}
+
+bool BBDocument::applyEdit(std::size_t offset, std::size_t removedLength, const std::string& inserted)
+{
+    switch (checkEdit(offset, removedLength, inserted.size()))
+    {
+        case BBStatus::OUT_OF_RANGE:
+            BBCPP_THROW(std::out_of_range("Edit is outside the document source"));
+
+        case BBStatus::SOURCE_TOO_LARGE:
+            BBCPP_THROW(std::length_error("BBCode source is larger than 4 GB"));
+
+        default:
+        break;
+    }
+
+    // No token contains a '[' past its first byte, and the tokens after any
+    // '[' only depend on the input from there on. So the edit can only change
+    // the tokens between the last '[' before it and the first '[' after it.
+    const auto editEnd = offset + removedLength;
+    const auto previous = offset > 0 ? _source.rfind('[', offset - 1) : std::string::npos;
+    const auto next = _source.find('[', editEnd);
+    const std::size_t dirtyBegin = previous == std::string::npos ? 0 : previous;
+    const std::size_t dirtyEnd = next == std::string::npos ? _source.size() : next;
+    const auto delta = static_cast<std::int64_t>(inserted.size()) - static_cast<std::int64_t>(removedLength);
+
+    _source.replace(offset, removedLength, inserted);
+
+    // the counters behind ParseLimits cover a whole load(), and tags an
+    // earlier load refused still take their closers
+    if (hasLimits(_options.limits) || !_refused.empty())
+    {
+        reparse();
+        return false;
+    }
+
+    // walk down to the deepest element whose content holds the dirty range
+    std::vector<BBNodePtr> path;
+    std::vector<std::size_t> pathIndex;
+    BBNode* container = this;
+
+    for (;;)
+    {
+        const auto& children = container->_children;
+        const auto it = std::upper_bound(children.begin(), children.end(), dirtyBegin,
+            [](std::size_t position, const BBNodePtr& child) { return position < child->_sourceEnd; });
+
+        if (it == children.end() || (*it)->_nodeType != NodeType::ELEMENT || isClosing(**it)
+            || (*it)->_contentBegin > dirtyBegin || dirtyEnd > (*it)->_contentEnd)
+        {
+            break;
+        }
+
+        path.push_back(*it);
+        pathIndex.push_back(static_cast<std::size_t>(it - children.begin()));
+        container = it->get();
+    }
+
+    // the children that overlap the dirty range, with the text next to them
+    // since new text at either end would merge into it
+    auto& children = container->_children;
+    const auto count = children.size();
+
+    std::size_t first = static_cast<std::size_t>(std::upper_bound(children.begin(), children.end(), dirtyBegin,
+        [](std::size_t position, const BBNodePtr& child) { return position < child->_sourceEnd; }) - children.begin());
+    std::size_t last = static_cast<std::size_t>(std::partition_point(children.begin(), children.end(),
+        [dirtyEnd](const BBNodePtr& child) { return child->_sourceBegin < dirtyEnd; }) - children.begin());
+    last = std::max(first, last);
+
+    // an element closed implicitly, like a list item by the next item, ends
+    // where the first child of the fragment begins and may go on past it now
+    if (first > 0 && first < count && children[first - 1]->_nodeType == NodeType::ELEMENT
+        && !isClosing(*children[first - 1]) && !isClosed(*children[first - 1])
+        && children[first - 1]->_sourceEnd == children[first]->_sourceBegin)
+    {
+        first--;
+    }
+
+    if (first > 0 && children[first - 1]->_nodeType == NodeType::TEXT)
+    {
+        first--;
+    }
+    if (last < count && children[last]->_nodeType == NodeType::TEXT)
+    {
+        last++;
+    }
+
+    const std::size_t fragmentBegin = first < count ? children[first]->_sourceBegin : std::size_t(container->_contentEnd);
+    const std::size_t fragmentEnd = last > first ? children[last - 1]->_sourceEnd : fragmentBegin;
+
+    // elements opened by the new markup may stay open only if nothing
+    // follows, so only at the end of an element that is still open; an
+    // element closed by an outer tag has no closer of its own but is followed
+    // by that tag
+    bool open = true;
+    for (std::size_t level = 0; level < path.size() && open; level++)
+    {
+        const auto& siblings = (level == 0 ? static_cast<BBNode*>(this) : path[level - 1].get())->_children;
+        open = pathIndex[level] + 1 == siblings.size() && !isClosed(*path[level]);
+    }
+    const bool tail = last == count && open;
+
+    if (fragmentBegin > dirtyBegin || fragmentEnd < dirtyEnd)
+    {
+        reparse();
+        return false;
+    }
+
+    BBNodeList removed(children.begin() + first, children.begin() + last);
+    BBNodeList suffix(children.begin() + last, children.end());
+    children.erase(children.begin() + first, children.end());
+
+    clearStack();
+    for (const auto& element : path)
+    {
+        pushElement(element);
+    }
+
+    NullParseMetrics metrics;
+    NullParseTrace trace;
+    const auto stopAt = _source.data() + static_cast<std::size_t>(static_cast<std::int64_t>(fragmentEnd) + delta);
+    const auto balanced = parse(_source.data() + fragmentBegin, stopAt, _source.data() + _source.size(),
+        path.size(), _options, metrics, trace);
+
+    if (!balanced || (_stack.size() != path.size() && !tail))
+    {
+        reparse();
+        return false;
+    }
+
+    // everything after the fragment keeps its nodes and moves by delta
+    const auto move = [delta](BBNode& root)
+    {
+        std::vector<BBNode*> pending{ &root };
+        while (!pending.empty())
+        {
+            auto node = pending.back();
+            pending.pop_back();
+
+            node->_sourceBegin = static_cast<std::uint32_t>(node->_sourceBegin + delta);
+            node->_contentBegin = static_cast<std::uint32_t>(node->_contentBegin + delta);
+            node->_contentEnd = static_cast<std::uint32_t>(node->_contentEnd + delta);
+            node->_sourceEnd = static_cast<std::uint32_t>(node->_sourceEnd + delta);
+            for (const auto& child : node->_children)
+            {
+                pending.push_back(child.get());
+            }
+        }
+    };
+
+    for (auto& node : suffix)
+    {
+        move(*node);
+        children.push_back(std::move(node));
+    }
+
+    for (auto level = path.size(); level-- > 0;)
+    {
+        path[level]->_contentEnd = static_cast<std::uint32_t>(path[level]->_contentEnd + delta);
+        path[level]->_sourceEnd = static_cast<std::uint32_t>(path[level]->_sourceEnd + delta);
+
+        const auto& siblings = (level == 0 ? static_cast<BBNode*>(this) : path[level - 1].get())->_children;
+        for (auto sibling = pathIndex[level] + 1; sibling < siblings.size(); sibling++)
+        {
+            move(*siblings[sibling]);
+        }
+    }
+
+    _contentEnd = _sourceEnd = static_cast<std::uint32_t>(_source.size());
+
+    // take the replaced nodes out of the statistics
+    const auto uncount = [this](const BBNode& node, std::size_t depth)
+    {
+        if (node._nodeType == NodeType::TEXT)
+        {
+            _stats.textNodeCount--;
+            _stats.textLength -= node._name.size();
+        }
+        else if (isClosing(node))
+        {
+            _stats.closingCount--;
+        }
+        else if (node._nodeType == NodeType::ELEMENT)
+        {
+            _stats.elementCount--;
+            _depthCounts[depth]--;
+
+            const auto entry = _stats.tagHistogram.find(histogramKey(static_cast<const BBElement&>(node).getTagId()));
+            if (entry != _stats.tagHistogram.end() && --entry->second == 0)
+            {
+                _stats.tagHistogram.erase(entry);
+            }
+        }
+        return VisitResult::CONTINUE;
+    };
+
+    const auto depth = path.size() + 1;
+    for (const auto& node : removed)
+    {
+        uncount(*node, depth);
+        traverse(*node, [&uncount, depth](const BBNode& child, std::size_t level) { return uncount(child, depth + 1 + level); });
+    }
+
+    while (_stats.maxDepth > 0 && _depthCounts[_stats.maxDepth] == 0)
+    {
+        _stats.maxDepth--;
+    }
+
+    rebuildStack();
+    return true;
+}
+
+void BBDocument::reparse()
+{
+    _children.clear();
+    clearStack();
+    _stats = BBDocumentStats();
+    _depthCounts.clear();
+    _contentEnd = _sourceEnd = static_cast<std::uint32_t>(_source.size());
+
+    NullParseMetrics metrics;
+    NullParseTrace trace;
+    const auto end = _source.data() + _source.size();
+    parse(_source.data(), end, end, 0, _options, metrics, trace);
+}
+
+void BBDocument::rebuildStack()
+{
+    // the open elements are the unclosed last children from the document down
+    clearStack();
+
+    BBNode* node = this;
+    while (!node->_children.empty())
+    {
+        const auto& last = node->_children.back();
+        if (last->_nodeType != NodeType::ELEMENT || isClosing(*last) || isClosed(*last))
+        {
+            break;
+        }
+
+        pushElement(last);
+        node = last.get();
+    }
+}
 
 } // namespace
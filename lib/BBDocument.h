@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -10,6 +11,24 @@
 #include <iterator>
 #include <cctype>
 #include <cstring>
+#include <string_view>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+// Where the library would throw, a build without exceptions (-fno-exceptions)
+// aborts instead. The tryLoad(), tryApplyEdit() and find...() calls report
+// the same errors without throwing.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define BBCPP_EXCEPTIONS 1
+#endif
+
+#ifdef BBCPP_EXCEPTIONS
+#define BBCPP_THROW(exception) throw exception
+#else
+#define BBCPP_THROW(exception) std::abort()
+#endif
 
 namespace bbcpp
 {
@@ -35,551 +54,1797 @@ inline bool IsSpace(char c)
     return std::isspace(static_cast<unsigned char>(c)) != 0;
 }
 
-class BBNode;
-class BBText;
-class BBElement;
-class BBDocument;
-
-using BBNodePtr = std::shared_ptr<BBNode>;
-using BBTextPtr = std::shared_ptr<BBText>;
-using BBElementPtr = std::shared_ptr<BBElement>;
-
-using BBNodeWeakPtr = std::weak_ptr<BBNode>;
-using BBNodeList = std::vector<BBNodePtr>;
-using BBNodeStack = std::stack<BBNodePtr>;
-using BBDocumentPtr = std::shared_ptr<BBDocument>;
+inline bool IsValueChar(char c)
+{
+    // an unquoted value runs to the closing bracket, so urls keep their
+    // query strings; spaces separate pairs, a '[' starts another tag and
+    // quotes only wrap a whole value
+    switch (c)
+    {
+        case ']': case '[': case '"': case '\'':
+            return false;
 
-using ParameterMap = std::map<std::string, std::string>;
+        default:
+            return !IsSpace(c);
+    }
+}
 
-class BBNode : public std::enable_shared_from_this<BBNode>
+// the value of a quoted attribute without the backslash of its escapes,
+// "John \"JJ\" Smith" is John "JJ" Smith
+inline std::string UnescapeValue(std::string_view value)
 {
-    template<typename NewTypePtrT>
-    NewTypePtrT cast(BBNodePtr node, bool bThrowOnFail)
+    if (value.find('\\') == std::string_view::npos)
     {
-        if (node == nullptr && !bThrowOnFail)
-        {
-            return NewTypePtrT();
-        }
-        else if (node == nullptr)
+        return std::string(value);
+    }
+
+    std::string result;
+    result.reserve(value.size());
+    for (std::size_t i = 0; i < value.size(); i++)
+    {
+        if (value[i] == '\\' && i + 1 < value.size())
         {
-            throw std::invalid_argument("Cannot downcast BBNode, object is null");
+            i++;
         }
+        result += value[i];
+    }
+    return result;
+}
 
-        NewTypePtrT newobj = std::dynamic_pointer_cast<typename NewTypePtrT::element_type, BBNode>(node);
+// Typed readings of a tag value, each false when `text` is not one:
+// #rgb, #rgba, #rrggbb, #rrggbbaa or a CSS color name as 0xRRGGBBAA; a
+// decimal integer; a URL that is safe to link to, without the spaces
+// around it. Defined with BBDocument.
+bool DecodeColor(std::string_view text, std::uint32_t& rgba);
+bool DecodeInteger(std::string_view text, std::int64_t& value);
+bool DecodeUrl(std::string_view text, std::string_view& url);
 
-        if (newobj == nullptr && bThrowOnFail)
+// the ASCII lower case of every byte
+struct FoldCaseTable
+{
+    unsigned char   map[256];
+
+    constexpr FoldCaseTable()
+        : map()
+    {
+        for (int c = 0; c < 256; c++)
         {
-            throw std::invalid_argument("Cannot downcast, object is not correct type");
+            map[c] = static_cast<unsigned char>(('A' <= c && c <= 'Z') ? c - 'A' + 'a' : c);
         }
-
-        return newobj;
     }
+};
 
-    template<typename NewTypePtrT>
-    NewTypePtrT cast(BBNodePtr node, bool bThrowOnFail) const
+inline constexpr FoldCaseTable FoldCaseMap;
+
+inline char FoldCase(char c)
+{
+    return static_cast<char>(FoldCaseMap.map[static_cast<unsigned char>(c)]);
+}
+
+using BBTagId = std::uint32_t;
+
+// Canonical ids of the common tags, whatever case they are written in. Other
+// names get ids from COUNT up, assigned by the document that parsed them (see
+// BBDocument::getTagId()), so matching tags is a single integer compare.
+struct BBTag
+{
+    enum : BBTagId
     {
-        if (node == nullptr && !bThrowOnFail)
+        B,
+        I,
+        U,
+        S,
+        CODE,
+        QUOTE,
+        URL,
+        IMG,
+        COLOR,
+        SIZE,
+        LIST,
+        NOPARSE,
+        STAR,
+        HR,
+        BR,
+        COUNT,
+        NONE = std::numeric_limits<BBTagId>::max()
+    };
+
+    static constexpr std::size_t MaxNameLength = 7;
+    static constexpr std::string_view Names[COUNT] =
+        { "b", "i", "u", "s", "code", "quote", "url", "img", "color", "size", "list", "noparse", "*", "hr", "br" };
+
+    // the id of a common tag, or NONE
+    static BBTagId find(std::string_view name)
+    {
+        if (name.size() > MaxNameLength)
         {
-            return NewTypePtrT();
+            return NONE;
         }
-        else if (node == nullptr)
+
+        char folded[MaxNameLength];
+        for (std::size_t i = 0; i < name.size(); i++)
         {
-            throw std::invalid_argument("Cannot downcast, BBNode object is null");
+            folded[i] = FoldCase(name[i]);
         }
 
-        NewTypePtrT newobj = std::dynamic_pointer_cast<typename NewTypePtrT::element_type, BBNode>(node);
-
-        if (newobj == nullptr && bThrowOnFail)
+        const std::string_view key(folded, name.size());
+        for (BBTagId id = 0; id < COUNT; id++)
         {
-            throw std::invalid_argument("Cannot downcast, object is not correct type");
+            if (Names[id] == key)
+            {
+                return id;
+            }
         }
 
-        return newobj;
+        return NONE;
     }
+};
 
-public:
-    enum class NodeType
+// A single lexical unit of BBCode. All views point into the tokenized input,
+// so producing a token never allocates.
+struct BBToken
+{
+    enum class Type
     {
-        DOCUMENT,
-        ELEMENT,    // [b]bold[/b], [QUOTE], [QUOTE=Username;1234], [QUOTE user=Bob]
-        TEXT,       // plain text
-        ATTRIBUTE
+        END,        // no more input
+        TEXT,       // plain text, including tags that failed to parse
+        ELEMENT,    // [b], [color=red], [style color=red]
+        CLOSING     // [/b]
     };
 
-    BBNode(NodeType nodeType, const std::string& name);
-    virtual ~BBNode() = default;
-
-    const std::string& getNodeName() const { return _name; }
-    NodeType getNodeType() const { return _nodeType; }
-    BBNodePtr getParent() const { return BBNodePtr(_parent); }
-
-    const BBNodeList& getChildren() const { return _children; }
-
-    virtual void appendChild(BBNodePtr node)
-    {
-        _children.push_back(node);
-        node->_parent = shared_from_this();
-    }
+    Type                type = Type::END;
+    std::string_view    source;     // the whole token as it appears in the input
+    std::string_view    name;       // element name
+    std::string_view    key;        // first parameter key, empty for [tag=value] and for elements without one
+    std::string_view    value;      // first parameter value, or the value of [tag=value]
+    std::string_view    attributes; // every pair of [quote name="John Smith" post=5], for BBAttributeLexer
+    std::size_t         parameterCount = 0;
+    BBTagId             tagId = BBTag::NONE;    // BBTag id of the name, NONE for other names
 
-    template<typename NewTypePtrT>
-	NewTypePtrT downCast(bool bThrowOnFail = true)
-	{
-		return cast<NewTypePtrT>(shared_from_this(), bThrowOnFail);
-	}
+    bool hasParameter() const { return parameterCount > 0; }
 
-    template<typename NewTypePtrT>
-	NewTypePtrT downCast(bool bThrowOnFail = true) const
-	{
-		return cast<NewTypePtrT>(shared_from_this(), bThrowOnFail);
-	}
+    // [color=red] rather than [style color=red]
+    bool hasValue() const { return parameterCount > 0 && key.empty(); }
+};
 
-protected:
-    std::string     _name;
-    NodeType        _nodeType;
-    BBNodeWeakPtr   _parent;
-    BBNodeList      _children;
+// A [begin, end) byte range of BBDocument::getSource()
+struct BBSourceSpan
+{
+    std::uint32_t   begin = 0;
+    std::uint32_t   end = 0;
 
-    friend class BBText;
-    friend class BBDocument;
-    friend class BBElement;
+    std::size_t size() const { return end - begin; }
+    bool empty() const { return begin == end; }
 };
 
-class BBText : public BBNode
+// Splits BBCode into text and tag tokens. This holds the grammar used by
+// BBDocument::load(), but can also be driven directly by callers that only
+// need to look at the markup (link scanning, counting, validation) without
+// paying for a tree.
+class BBTokenizer
 {
 public:
-    BBText(const std::string& value)
-        : BBNode(BBNode::NodeType::TEXT, value)
+    // `strictAttributes` keeps the original grammar: one unquoted key=value
+    // per tag with nothing around the '='
+    BBTokenizer(const char* begin, const char* end, bool strictAttributes = false)
+        : _begin(begin), _end(end), _current(begin), _strict(strictAttributes)
     {
         // nothing to do
     }
 
-    virtual ~BBText() = default;
-
-    virtual const std::string getText() const { return _name; }
-
-    void append(const std::string& text)
+    explicit BBTokenizer(std::string_view text, bool strictAttributes = false)
+        : BBTokenizer(text.data(), text.data() + text.size(), strictAttributes)
     {
-        _name.append(text);
+        // nothing to do
     }
-};
 
-class BBElement : public BBNode
-{
-public:
-    enum ElementType
+    // fills `token` with the next token, returns false at the end of the input
+    bool next(BBToken& token)
     {
-        SIMPLE,     // [b]bold[/b], [code]print("hello")[/code]
-        VALUE,      // [QUOTE=Username;12345]This is a quote[/QUOTE] (mostly used by vBulletin)
-        PARAMETER,  // [QUOTE user=Bob userid=1234]This is a quote[/QUOTE]
-        CLOSING     // [/b], [/code]
-    };
+        token = BBToken{};
 
-    BBElement(const std::string& name, ElementType et = BBElement::SIMPLE)
-        : BBNode(BBNode::NodeType::ELEMENT, name),
-          _elementType(et)
+        if (_current == _end)
+        {
+            return false;
+        }
+
+        if (*_current == '[')
+        {
+            _current = parseElement(_current, _end, token, _strict);
+        }
+        else
+        {
+            _current = parseText(_current, _end, token);
+        }
+
+        return true;
+    }
+
+    // Finds the closing tag `[/name]`, in any case, in [begin, end). The
+    // search only stops at brackets, which memchr finds many bytes at a time.
+    static const char* findClosingTag(const char* begin, const char* end, std::string_view name)
     {
-        // nothing to do
+        const auto length = name.size() + 3;
+        for (auto it = begin; static_cast<std::size_t>(end - it) >= length; it++)
+        {
+            it = static_cast<const char*>(std::memchr(it, '[', static_cast<std::size_t>(end - it) - length + 1));
+            if (it == nullptr)
+            {
+                break;
+            }
+
+            if (it[1] == '/' && it[length - 1] == ']')
+            {
+                std::size_t i = 0;
+                while (i < name.size() && FoldCase(it[2 + i]) == FoldCase(name[i]))
+                {
+                    i++;
+                }
+
+                if (i == name.size())
+                {
+                    return it;
+                }
+            }
+        }
+
+        return nullptr;
     }
 
-    virtual ~BBElement() = default;
+    // byte offset of the next token from the start of the input
+    std::size_t position() const { return static_cast<std::size_t>(_current - _begin); }
 
-    const ElementType getElementType() const { return _elementType; }
+    void setPosition(std::size_t offset) { _current = _begin + offset; }
 
-    void setOrAddParameter(const std::string& key, const std::string& value, bool addIfNotExists = true)
+    // After `opener`, moves past the content of a [code] or [noparse]
+    // element up to its closing tag, the content load() keeps as one text
+    // node with the default ParseOptions::rawTags. Streaming callers use it
+    // to see the same tags as load(). False for any other token.
+    bool skipRaw(const BBToken& opener, std::string_view& content)
     {
-        _parameters.insert({key,value});
+        if (opener.type != BBToken::Type::ELEMENT || (opener.tagId != BBTag::CODE && opener.tagId != BBTag::NOPARSE))
+        {
+            return false;
+        }
+
+        const auto closer = findClosingTag(_current, _end, opener.name);
+        const auto contentEnd = closer != nullptr ? closer : _end;
+        content = std::string_view(_current, static_cast<std::size_t>(contentEnd - _current));
+        _current = contentEnd;
+        return true;
     }
 
-    std::string getParameter(const std::string& key, bool bDoThrow = true)
+    static const char* parseText(const char* begin, const char* end, BBToken& token)
     {
-        if (_parameters.find(key) == _parameters.end() && bDoThrow)
+        auto endingChar = static_cast<const char*>(std::memchr(begin, '[', static_cast<std::size_t>(end - begin)));
+
+        if (endingChar == nullptr || endingChar == begin)
         {
-            throw std::invalid_argument("Undefine attribute '" + key + "'");
+            endingChar = end;
         }
 
-        return _parameters.at(key);
+        setToken(token, BBToken::Type::TEXT, begin, endingChar);
+        return endingChar;
     }
 
-    const ParameterMap& getParameters() const { return _parameters; }
+    static const char* parseElementName(const char* begin, const char* end, std::string_view& name)
+    {
+        // TODO: alphanumeric names only?
+        for (auto it = begin; it != end; it++)
+        {
+            if (!bbcpp::IsAlNum(*it))
+            {
+                name = std::string_view(begin, static_cast<std::size_t>(it - begin));
+                return it;
+            }
+        }
 
-private:
-    ElementType       _elementType = BBElement::SIMPLE;
-    ParameterMap      _parameters;
-};
+        return begin;
+    }
 
-class BBDocument : public BBNode
-{
-    BBDocument()
-        : BBNode(BBNode::NodeType::DOCUMENT, "#document")
+    static const char* skipSpaces(const char* begin, const char* end)
     {
-        // nothing to do
+        while (begin != end && bbcpp::IsSpace(*begin))
+        {
+            begin++;
+        }
+        return begin;
     }
 
-	template <typename citerator>
-    citerator parseText(citerator begin, citerator end)
+    // Reads a value and, unless strict, the spaces after it. Returns where
+    // it stopped; `value` is only set when a value was read. Quoted values
+    // come without their quotes but keep their backslash escapes (see
+    // UnescapeValue()), and may hold anything but a '[' so that every token
+    // still starts at the only '[' it contains.
+    static const char* parseValue(const char* begin, const char* end, std::string_view& value, bool strict = false)
     {
-        auto endingChar = begin;
+        auto start = skipSpaces(begin, end);
+        if (start == end)
+        {
+            return end;
+        }
 
-        for (auto it = begin; it != end; it++)
+        if (!strict && (*start == '"' || *start == '\''))
         {
-            if (*it == '[')
+            const auto quote = *start;
+            for (auto it = std::next(start); it != end && *it != '['; it++)
             {
-                endingChar = it;
-                break;
+                if (*it == '\\' && std::next(it) != end)
+                {
+                    it++;
+                }
+                else if (*it == quote)
+                {
+                    value = std::string_view(std::next(start), static_cast<std::size_t>(it - start - 1));
+                    return skipSpaces(std::next(it), end);
+                }
             }
+
+            return end;
         }
 
-        if (endingChar == begin)
+        auto it = start;
+        while (it != end && bbcpp::IsValueChar(*it))
         {
-            endingChar = end;
+            it++;
         }
 
-        newText(std::string(begin, endingChar));
+        // a strict value ends right at the closing bracket; an unquoted value
+        // of either kind is never empty
+        if (it == start || it == end || (strict && *it != ']'))
+        {
+            return it;
+        }
 
-        return endingChar;
+        value = std::string_view(start, static_cast<std::size_t>(it - start));
+        return strict ? it : skipSpaces(it, end);
     }
 
-     template <typename citerator>
-     citerator parseElementName(citerator begin, citerator end, std::string& buf)
-     {
-         auto start = begin;
-         std::stringstream str;
-
-         for (auto it = start; it != end; it++)
-         {
-             // TODO: alphanumeric names only?
-            if (bbcpp::IsAlNum((char)*it))
-            {
-                str << *it;
-            }
-            else
-            {
-                buf.assign(str.str());
-                return it;
-            }
-         }
-
-         return start;
-     }
-
-     template <typename citerator>
-     citerator parseValue(citerator begin, citerator end, std::string& value)
-     {
-         auto start = begin;
-         while (bbcpp::IsSpace(*start) && start != end)
-         {
-             start++;
-         }
-
-         if (start == end)
-         {
-             // we got to the end and there was nothing but spaces
-             // so return our starting point so the caller can create
-             // a text node with those spaces
-             return end;
-         }
-
-         std::stringstream temp;
-
-         for (auto it = start; it != end; it++)
-         {
-             if (bbcpp::IsAlNum(*it))
-             {
-                 temp << *it;
-             }
-             else if (*it == ']')
-             {
-                 value.assign(temp.str());
-                 return it;
-             }
-             else if(*it == '#')
-             {
-                 //is color
-                 temp << *it;
-             }
-             else if (*it == ':' || *it == '/' || *it == '.' || *it == '&'
-                      || *it == '?' || *it == '$' || *it == '-' || *it == '+'
-                      || *it == '*' || *it == '(' || *it == ')' || *it == ','
-                      || *it == '@' || *it == '_')
-             {
-                 //is url or email
-                 temp << *it;
-             }
-             else
-             {
-                 // some invalid character, so return the point where
-                 // we stopped parsing
-                 return it;
-             }
-         }
-
-         // if we get here then we're at the end, so we return the starting
-         // point so the callerd can create a text node
-         return end;
-     }
-
-    template <typename citerator>
-    citerator parseKey(citerator begin, citerator end, std::string& keyname)
-    {
-        auto start = begin;
-        while (bbcpp::IsSpace(*start) && start != end)
-        {
-            start++;
+    // Reads a key up to its '=', the returned pointer is at the '=' when
+    // `keyname` was set.
+    static const char* parseKey(const char* begin, const char* end, std::string_view& keyname, bool strict = false)
+    {
+        auto start = skipSpaces(begin, end);
+        auto it = start;
+        while (it != end && bbcpp::IsAlNum(*it))
+        {
+            it++;
         }
 
-        if (start == end)
+        const auto keyEnd = it;
+        if (!strict)
         {
-            // we got to the end and there was nothing but spaces
-            // so return our end point so the caller can create
-            // a text node with those spaces
-            return start;
+            it = skipSpaces(it, end);
         }
 
-        std::stringstream temp;
-
-        // TODO: need to handle spaces after the key name and before
-        // the equal sign (ie. "[style color  =red]")
-        for (auto it = start; it != end; it++)
+        if (keyEnd != start && it != end && *it == '=')
         {
-            if (bbcpp::IsAlNum(*it))
-            {
-                temp << *it;
-            }
-            else if (*it == '=')
-            {
-                keyname.assign(temp.str());
-                return it;
-            }
-            else
-            {
-                // some invalid character, so return the point where
-                // we stopped parsing
-                return it;
-            }
+            keyname = std::string_view(start, static_cast<std::size_t>(keyEnd - start));
         }
 
-        // if we get here then we're at the end, so we return the starting
-        // point so the callerd can create a text node
-        return end;
+        return it;
     }
 
-    template <typename citerator>
-    citerator parseKeyValuePairs(citerator begin, citerator end, ParameterMap& pairs)
+    // Parses the `key=value` pairs up to the closing bracket. On success the
+    // returned pointer is at that bracket, and `token` holds the first pair,
+    // the pair count and the attributes to walk with BBAttributeLexer.
+    // Pairs are separated by spaces; strict parsing reads only one.
+    static const char* parseKeyValuePairs(const char* begin, const char* end, BBToken& token, bool strict = false)
     {
-        auto current = begin;
-        std::string tempKey;
-        std::string tempVal;
+        std::string_view firstKey;
+        std::string_view firstValue;
+        std::size_t count = 0;
 
-        while (current != end)
+        auto current = begin;
+        do
         {
-            current = parseKey(current, end, tempKey);
-            if (tempKey.empty())
+            if (count > 0 && !bbcpp::IsSpace(current[-1]))
             {
-                pairs.clear();
                 return current;
             }
 
-            if (*current != '=')
+            std::string_view key;
+            std::string_view value;
+
+            current = parseKey(current, end, key, strict);
+            if (key.empty())
             {
-                pairs.clear();
                 return current;
             }
 
-            current = std::next(current);
-            current = parseValue(current, end, tempVal);
-
-            if (tempKey.empty() || tempVal.empty())
+            current = parseValue(std::next(current), end, value, strict);
+            if (value.data() == nullptr)
             {
-                pairs.clear();
                 return current;
             }
 
-            pairs.insert(std::make_pair(tempKey, tempVal));
-            if (*current == ']')
+            if (count++ == 0)
             {
-                // this is the only valid condition for key/value pairs so we do
-                // not want to clear `pairs` like in the other cases
-                return current;
+                firstKey = key;
+                firstValue = value;
             }
         }
+        while (!strict && current != end && *current != ']');
+
+        if (current == end || *current != ']')
+        {
+            return current;
+        }
 
-        return end;
+        token.key = firstKey;
+        token.value = firstValue;
+        token.attributes = std::string_view(begin, static_cast<std::size_t>(current - begin));
+        token.parameterCount = count;
+        return current;
     }
 
-    template <typename citerator>
-    citerator parseElement(citerator begin, citerator end)
+    static const char* parseElement(const char* begin, const char* end, BBToken& token, bool strict = false)
     {
-        bool closingTag = false;
+        auto type = BBToken::Type::ELEMENT;
 
         // the first non-[ and non-/ character
         auto nameStart = std::next(begin);
 
-        std::string elementName;
-
         // this might be a closing tag so mark it
-        if (*nameStart == '/')
+        if (nameStart != end && *nameStart == '/')
         {
-            closingTag = true;
+            type = BBToken::Type::CLOSING;
             nameStart = std::next(nameStart);
         }
 
+        std::string_view elementName;
         auto nameEnd = parseElementName(nameStart, end, elementName);
 
+        // list items, [*]
+        if (elementName.empty() && nameStart != end && *nameStart == '*')
+        {
+            elementName = std::string_view(nameStart, 1);
+            nameEnd = std::next(nameStart);
+        }
+
         // no valid name was found, so bail out
         if (elementName.empty())
         {
-            newText(std::string{*begin});
+            setToken(token, BBToken::Type::TEXT, begin, nameEnd);
             return nameEnd;
         }
-        else if (nameEnd == end)
-        {
-            newText(std::string(begin,end));
-            return end;
-        }
 
-        if (*nameEnd == ']')
+        if (nameEnd != end && *nameEnd == ']')
         {
             // end of element
+            setToken(token, type, begin, std::next(nameEnd));
+            token.name = elementName;
+            token.tagId = BBTag::find(elementName);
+            return std::next(nameEnd);
         }
-        else if (*nameEnd == '=')
+        else if (nameEnd != end && (*nameEnd == '=' || *nameEnd == ' ') && type == BBToken::Type::ELEMENT)
         {
-            // possibly a QUOTE value element
-            // possibly key-value pairs of a QUOTE
-            ParameterMap pairs;
-
-            auto kvEnd = parseKeyValuePairs(nameStart, end, pairs);
-            if (pairs.size() == 0)
+            // [color=red] has a value, [style color=red] the pairs following
+            // the name; [color = red] is a value too unless strict. Closing
+            // tags take neither.
+            const auto equals = strict ? nameEnd : skipSpaces(nameEnd, end);
+            const char* kvEnd = nullptr;
+            if (equals != end && *equals == '=')
             {
-                newText(std::string(begin, kvEnd));
-                return kvEnd;
+                std::string_view value;
+                kvEnd = parseValue(std::next(equals), end, value, strict);
+                if (value.data() != nullptr && kvEnd != end && *kvEnd == ']')
+                {
+                    token.value = value;
+                    token.parameterCount = 1;
+                }
             }
             else
             {
-                newKeyValueElement(elementName, pairs);
-                // TODO: add 'pairs'
-                return std::next(kvEnd);
+                kvEnd = parseKeyValuePairs(nameEnd, end, token, strict);
             }
-        }
-        else if (*nameEnd == ' ')
-        {
-            // possibly key-value pairs of a QUOTE
-            ParameterMap pairs;
 
-            auto kvEnd = parseKeyValuePairs(nameEnd, end, pairs);
-            if (pairs.size() == 0)
+            if (!token.hasParameter())
             {
-                newText(std::string(begin, kvEnd));
+                setToken(token, BBToken::Type::TEXT, begin, kvEnd);
                 return kvEnd;
             }
-            else
-            {
-                newKeyValueElement(elementName, pairs);
-                // TODO: add 'pairs'
-                return std::next(kvEnd);
-            }
-        }
-        else
-        {
-            // some invalid char proceeded the element name, so it's not actually a
-            // valid element, so create it as text and move on
-            newText(std::string(begin,nameEnd));
-            return nameEnd;
-        }
 
-        if (closingTag)
-        {
-            newClosingElement(elementName);
-        }
-        else
-        {
-            newElement(elementName);
+            setToken(token, BBToken::Type::ELEMENT, begin, std::next(kvEnd));
+            token.name = elementName;
+            token.tagId = BBTag::find(elementName);
+            return std::next(kvEnd);
         }
 
-        return std::next(nameEnd);
+        // some invalid char proceeded the element name, so it's not actually a
+        // valid element, so create it as text and move on
+        setToken(token, BBToken::Type::TEXT, begin, nameEnd);
+        return nameEnd;
     }
 
-public:
-    static BBDocumentPtr create()
+private:
+    const char*     _begin;
+    const char*     _end;
+    const char*     _current;
+    bool            _strict = false;
+
+    static void setToken(BBToken& token, BBToken::Type type, const char* begin, const char* end)
     {
-        BBDocumentPtr doc = BBDocumentPtr(new BBDocument());
-        return doc;
+        token.type = type;
+        token.source = std::string_view(begin, static_cast<std::size_t>(end - begin));
+    }
+};
+
+// Walks the pairs of BBToken::attributes: [quote name="John Smith" post=5]
+// gives name and John Smith, then post and 5. The views point into the
+// tokenized input; quoted values keep their escapes (see UnescapeValue()).
+class BBAttributeLexer
+{
+public:
+    // `attributes` must come from a token, the ']' after it ends the last value
+    explicit BBAttributeLexer(std::string_view attributes)
+        : _current(attributes.data()), _end(attributes.data() + attributes.size())
+    {
+        // nothing to do
+    }
+
+    bool next(std::string_view& key, std::string_view& value)
+    {
+        if (_current >= _end)
+        {
+            return false;
+        }
+
+        key = value = std::string_view();
+        _current = BBTokenizer::parseKey(_current, std::next(_end), key);
+        _current = BBTokenizer::parseValue(std::next(_current), std::next(_end), value);
+        return true;
+    }
+
+private:
+    const char*     _current;
+    const char*     _end;
+};
+
+// Maps tag names to small integer ids, ignoring case. A lookup costs one hash
+// and a short probe no matter how many names the table holds.
+class BBTagTable
+{
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    // returns the id of `name`, adding it to the table if needed
+    std::size_t intern(std::string_view name);
+
+    // returns the id of `name`, or npos if it is not in the table
+    std::size_t find(std::string_view name) const
+    {
+        if (_slots.empty())
+        {
+            return npos;
+        }
+
+        const auto code = hash(name);
+        const auto mask = _slots.size() - 1;
+
+        for (auto slot = code & mask; _slots[slot] != 0; slot = (slot + 1) & mask)
+        {
+            const auto id = _slots[slot] - 1;
+            if (_hashes[id] == code && equals(_names[id], name))
+            {
+                return id;
+            }
+        }
+
+        return npos;
+    }
+
+    std::size_t size() const { return _names.size(); }
+    const std::string& getName(std::size_t id) const { return _names.at(id); }
+
+    static std::size_t hash(std::string_view name)
+    {
+        // FNV-1a over the case folded name
+        std::uint64_t code = 14695981039346656037ull;
+        for (auto c : name)
+        {
+            code = (code ^ static_cast<unsigned char>(FoldCase(c))) * 1099511628211ull;
+        }
+        return static_cast<std::size_t>(code);
+    }
+
+    static bool equals(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < a.size(); i++)
+        {
+            if (FoldCase(a[i]) != FoldCase(b[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    std::vector<std::string>    _names;
+    std::vector<std::size_t>    _hashes;
+    std::vector<std::uint32_t>  _slots;     // id + 1, zero marks an empty slot
+
+    void rehash(std::size_t slotCount);
+};
+
+class BBNode;
+class BBText;
+class BBElement;
+class BBDocument;
+class BBFrozenDocument;
+
+using BBNodePtr = std::shared_ptr<BBNode>;
+using BBTextPtr = std::shared_ptr<BBText>;
+using BBElementPtr = std::shared_ptr<BBElement>;
+
+using BBNodeWeakPtr = std::weak_ptr<BBNode>;
+using BBNodeList = std::vector<BBNodePtr>;
+using BBNodeStack = std::stack<BBNodePtr>;
+using BBDocumentPtr = std::shared_ptr<BBDocument>;
+using BBFrozenDocumentPtr = std::shared_ptr<const BBFrozenDocument>;
+
+using ParameterMap = std::map<std::string, std::string>;
+using TagHistogram = std::map<std::string, std::size_t>;
+
+// Counters maintained while the document is being built, so reading them
+// never requires walking the tree
+struct BBDocumentStats
+{
+    std::size_t     elementCount = 0;   // opening tags: [b], [color=red], [quote user=Bob]
+    std::size_t     closingCount = 0;   // closing tags: [/b]
+    std::size_t     textNodeCount = 0;  // text nodes created (merged text is counted once)
+    std::size_t     textLength = 0;     // total bytes of text content
+    std::size_t     maxDepth = 0;       // deepest element nesting seen
+    TagHistogram    tagHistogram;       // opening tag name in lower case -> number of occurrences
+    std::size_t     degradedTags = 0;   // tags kept as text because of ParseLimits
+    bool            truncated = false;  // a ParseLimits cap ended a load() early
+};
+
+// What BBDocument::tryLoad() and tryApplyEdit() found, where load() and
+// applyEdit() would throw or only set a flag
+enum class BBStatus
+{
+    OK,
+    TRUNCATED,          // a ParseLimits cap ended the load early, the tree holds what came before it
+    SOURCE_TOO_LARGE,   // the source would pass 4 GB, node offsets are 32 bits; nothing changed
+    OUT_OF_RANGE,       // an edit outside the source; nothing changed
+    INVALID_FORMAT      // not a buffer written by BBFrozenDocument::serialize()
+};
+
+const char* statusName(BBStatus status);
+
+// Caps that bound the time and memory one load() can use. Every check is a
+// comparison against a running counter, so enforcing them costs O(1) per
+// token. What happens when a cap is reached:
+//
+//  - maxDepth, maxParameters, maxTagNameLength: the offending opening tag is
+//    kept as text, and so is the next closing tag, so the closer of a refused
+//    tag does not close one of its ancestors instead
+//  - maxNodes: the node that would reach the cap holds the rest of the input
+//    as text and the load stops
+//  - maxTextLength: text is cut off at the cap and the load stops
+//
+// Refused tags are counted in BBDocumentStats::degradedTags; a load that
+// stopped early sets BBDocumentStats::truncated.
+struct ParseLimits
+{
+    static constexpr std::size_t Unlimited = std::numeric_limits<std::size_t>::max();
+
+    std::size_t     maxDepth = Unlimited;           // open elements at once
+    std::size_t     maxNodes = Unlimited;           // text, element and closing nodes created by one load()
+    std::size_t     maxTextLength = Unlimited;      // bytes of text created by one load()
+    std::size_t     maxParameters = Unlimited;      // tag parameters created by one load()
+    std::size_t     maxTagNameLength = Unlimited;   // bytes in a tag name
+};
+
+// How tags nest beyond opening and closing, for the tags that are not
+// written that way in practice. Tags without rules nest as usual. Names match
+// in any case.
+//
+//  - void tags ([hr], [br]) never have content: they close right away and
+//    their closing tags are text. addVoidTag(name, true) does this only when
+//    the tag has a value, for [img=url] next to [img width=100]url[/img]
+//  - addImplicitClose(name, sibling): opening `name` while a `sibling` is
+//    open closes that sibling first, with whatever was left open inside it,
+//    so each [*] ends the previous one
+//  - addParent(name, parent): `name` only opens directly inside one of its
+//    parents and is text anywhere else
+class BBTagSchema
+{
+public:
+    struct Rule
+    {
+        std::string                 name;
+        bool                        isVoid = false;
+        bool                        voidWithValue = false;
+        std::vector<std::string>    closes;
+        std::vector<std::string>    parents;
+    };
+
+    // [hr], [br] and [img=url] are void, [*] is a list item
+    static std::shared_ptr<const BBTagSchema> defaults();
+
+    BBTagSchema& addVoidTag(std::string_view name, bool onlyWithValue = false);
+    BBTagSchema& addImplicitClose(std::string_view name, std::string_view sibling);
+    BBTagSchema& addParent(std::string_view name, std::string_view parent);
+
+    const std::vector<Rule>& getRules() const { return _rules; }
+
+private:
+    std::vector<Rule>   _rules;
+
+    Rule& getRule(std::string_view name);
+};
+
+using BBTagSchemaPtr = std::shared_ptr<const BBTagSchema>;
+
+struct ParseOptions
+{
+    ParseLimits     limits;
+
+    // null parses every tag the same way
+    BBTagSchemaPtr  schema = BBTagSchema::defaults();
+
+    // Tags whose content is kept as one text node up to their closing tag,
+    // without looking for tags inside it. Names match in any case.
+    std::vector<std::string> rawTags = { "code", "noparse" };
+
+    // Only [tag key=value] with one unquoted value and nothing around the
+    // '=', as before quoted values, spaces and several pairs were read.
+    bool strictAttributes = false;
+};
+
+// Counters describing one BBDocument::load() call, for finding out which
+// posts are slow to parse and why. Recording only happens when one of these
+// is passed to load(); the plain load() records into NullParseMetrics and the
+// bookkeeping compiles away.
+struct ParseMetrics
+{
+    static constexpr bool enabled = true;
+
+    std::size_t     bytesScanned = 0;
+    std::size_t     textNodes = 0;      // text nodes created
+    std::size_t     elementNodes = 0;   // opening tags: [b], [color=red]
+    std::size_t     closingNodes = 0;   // closing tags: [/b]
+    std::size_t     textMerges = 0;     // text appended to the previous text node
+    std::size_t     failedTags = 0;     // '[' sequences that fell back to text
+    std::size_t     maxDepth = 0;       // deepest element stack during this load
+    std::size_t     allocations = 0;    // estimated heap allocations for nodes, names, parameters and child lists
+};
+
+struct NullParseMetrics
+{
+    static constexpr bool enabled = false;
+};
+
+// Parser phases timed by a trace policy
+enum class ParsePhase
+{
+    TOKENIZE,       // finding the next text run or tag in the input
+    PARAMETERS,     // turning tag parameters into a ParameterMap
+    NODES,          // creating text and element nodes
+    FIXUP,          // closing tags: attaching the closer and popping the open-element stack
+    COUNT
+};
+
+const char* parsePhaseName(ParsePhase phase);
+
+// Trace policy that records nothing. A trace policy provides `enabled`, a
+// `TimePoint` type, `begin()` and `end(phase, start)`; the parser calls them
+// around every phase, so this one compiles away entirely.
+struct NullParseTrace
+{
+    static constexpr bool enabled = false;
+
+    using TimePoint = int;
+
+    TimePoint begin() const { return 0; }
+    void end(ParsePhase, TimePoint) {}
+};
+
+// Trace policy that times every phase with steady_clock. Per-phase totals are
+// always kept; the first `maxEvents` scopes are also kept as individual events
+// for writeChromeTrace().
+class ParseTrace
+{
+public:
+    static constexpr bool enabled = true;
+
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    struct Event
+    {
+        ParsePhase          phase;
+        TimePoint           start;
+        Clock::duration     duration;
+    };
+
+    explicit ParseTrace(std::size_t maxEvents = 100000)
+        : _maxEvents(maxEvents)
+    {
+        _events.reserve(std::min<std::size_t>(maxEvents, 4096));
+    }
+
+    TimePoint begin() const { return Clock::now(); }
+
+    void end(ParsePhase phase, TimePoint start)
+    {
+        const auto duration = Clock::now() - start;
+        const auto index = static_cast<std::size_t>(phase);
+
+        _totals[index] += duration;
+        _counts[index]++;
+
+        if (_events.size() < _maxEvents)
+        {
+            _events.push_back(Event{ phase, start, duration });
+        }
+        else
+        {
+            _dropped++;
+        }
+    }
+
+    Clock::duration total(ParsePhase phase) const { return _totals[static_cast<std::size_t>(phase)]; }
+    std::size_t count(ParsePhase phase) const { return _counts[static_cast<std::size_t>(phase)]; }
+
+    const std::vector<Event>& events() const { return _events; }
+    std::size_t droppedEvents() const { return _dropped; }
+
+    // writes the recorded events as Chrome trace-event JSON, which can be
+    // opened in chrome://tracing or https://ui.perfetto.dev
+    void writeChromeTrace(std::ostream& os) const;
+
+private:
+    static constexpr std::size_t PhaseCount = static_cast<std::size_t>(ParsePhase::COUNT);
+
+    std::size_t         _maxEvents;
+    std::size_t         _dropped = 0;
+    std::vector<Event>  _events;
+    Clock::duration     _totals[PhaseCount] = {};
+    std::size_t         _counts[PhaseCount] = {};
+};
+
+// Times one phase for the lifetime of the scope
+template<typename TraceT>
+class ParseTraceScope
+{
+public:
+    ParseTraceScope(TraceT& trace, ParsePhase phase)
+        : _trace(trace), _phase(phase), _start(trace.begin())
+    {
+        // nothing to do
+    }
+
+    ~ParseTraceScope()
+    {
+        _trace.end(_phase, _start);
+    }
+
+    ParseTraceScope(const ParseTraceScope&) = delete;
+    ParseTraceScope& operator=(const ParseTraceScope&) = delete;
+
+private:
+    TraceT&                     _trace;
+    ParsePhase                  _phase;
+    typename TraceT::TimePoint  _start;
+};
+
+class BBNode : public std::enable_shared_from_this<BBNode>
+{
+    template<typename NewTypePtrT>
+    NewTypePtrT cast(BBNodePtr node, bool bThrowOnFail)
+    {
+        if (node == nullptr && !bThrowOnFail)
+        {
+            return NewTypePtrT();
+        }
+        else if (node == nullptr)
+        {
+            BBCPP_THROW(std::invalid_argument("Cannot downcast BBNode, object is null"));
+        }
+
+        NewTypePtrT newobj = std::dynamic_pointer_cast<typename NewTypePtrT::element_type, BBNode>(node);
+
+        if (newobj == nullptr && bThrowOnFail)
+        {
+            BBCPP_THROW(std::invalid_argument("Cannot downcast, object is not correct type"));
+        }
+
+        return newobj;
+    }
+
+    template<typename NewTypePtrT>
+    NewTypePtrT cast(BBNodePtr node, bool bThrowOnFail) const
+    {
+        if (node == nullptr && !bThrowOnFail)
+        {
+            return NewTypePtrT();
+        }
+        else if (node == nullptr)
+        {
+            BBCPP_THROW(std::invalid_argument("Cannot downcast, BBNode object is null"));
+        }
+
+        NewTypePtrT newobj = std::dynamic_pointer_cast<typename NewTypePtrT::element_type, BBNode>(node);
+
+        if (newobj == nullptr && bThrowOnFail)
+        {
+            BBCPP_THROW(std::invalid_argument("Cannot downcast, object is not correct type"));
+        }
+
+        return newobj;
+    }
+
+public:
+    enum class NodeType
+    {
+        DOCUMENT,
+        ELEMENT,    // [b]bold[/b], [QUOTE], [QUOTE=Username;1234], [QUOTE user=Bob]
+        TEXT,       // plain text
+        ATTRIBUTE
+    };
+
+    BBNode(NodeType nodeType, const std::string& name);
+    virtual ~BBNode();
+
+    const std::string& getNodeName() const { return _name; }
+    NodeType getNodeType() const { return _nodeType; }
+    BBNodePtr getParent() const { return BBNodePtr(_parent); }
+
+    // the bytes of BBDocument::getSource() this node was parsed from; an
+    // element runs from its opening tag to the end of its closing tag, or to
+    // where parsing stopped if it was never closed
+    std::size_t getSourceBegin() const { return _sourceBegin; }
+    std::size_t getSourceEnd() const { return _sourceEnd; }
+    BBSourceSpan getSourceSpan() const { return { _sourceBegin, _sourceEnd }; }
+
+    // The source split into opening tag, content and closing tag. A text
+    // node is all content, a closing element is all opening tag, and the
+    // closing tag of an unclosed element is empty.
+    BBSourceSpan getOpenTagSpan() const { return { _sourceBegin, _contentBegin }; }
+    BBSourceSpan getContentSpan() const { return { _contentBegin, _contentEnd }; }
+    BBSourceSpan getCloseTagSpan() const { return { _contentEnd, _sourceEnd }; }
+
+    const BBNodeList& getChildren() const { return _children; }
+
+    virtual void appendChild(BBNodePtr node)
+    {
+        _children.push_back(node);
+        node->_parent = shared_from_this();
+    }
+
+    template<typename NewTypePtrT>
+	NewTypePtrT downCast(bool bThrowOnFail = true)
+	{
+		return cast<NewTypePtrT>(shared_from_this(), bThrowOnFail);
+	}
+
+    template<typename NewTypePtrT>
+	NewTypePtrT downCast(bool bThrowOnFail = true) const
+	{
+		return cast<NewTypePtrT>(shared_from_this(), bThrowOnFail);
+	}
+
+protected:
+    std::string     _name;
+    NodeType        _nodeType;
+    std::uint32_t   _sourceBegin = 0;
+    std::uint32_t   _contentBegin = 0;
+    std::uint32_t   _contentEnd = 0;
+    std::uint32_t   _sourceEnd = 0;
+    BBNodeWeakPtr   _parent;
+    BBNodeList      _children;
+
+    friend class BBText;
+    friend class BBDocument;
+    friend class BBElement;
+};
+
+class BBText : public BBNode
+{
+public:
+    BBText(const std::string& value)
+        : BBNode(BBNode::NodeType::TEXT, value)
+    {
+        // nothing to do
+    }
+
+    virtual ~BBText() = default;
+
+    virtual const std::string getText() const { return _name; }
+
+    void append(const std::string& text)
+    {
+        _name.append(text);
+    }
+};
+
+class BBElement : public BBNode
+{
+public:
+    enum ElementType
+    {
+        SIMPLE,     // [b]bold[/b], [code]print("hello")[/code]
+        VALUE,      // [QUOTE=Username;12345]This is a quote[/QUOTE] (mostly used by vBulletin)
+        PARAMETER,  // [QUOTE user=Bob userid=1234]This is a quote[/QUOTE]
+        CLOSING     // [/b], [/code]
+    };
+
+    BBElement(const std::string& name, ElementType et = BBElement::SIMPLE)
+        : BBElement(name, et, BBTag::find(name))
+    {
+        // nothing to do
+    }
+
+    BBElement(const std::string& name, ElementType et, BBTagId tagId)
+        : BBNode(BBNode::NodeType::ELEMENT, name),
+          _elementType(et),
+          _tagId(tagId)
+    {
+        // nothing to do
+    }
+
+    virtual ~BBElement() = default;
+
+    const ElementType getElementType() const { return _elementType; }
+
+    // the canonical id of the name, getNodeName() keeps the original spelling
+    BBTagId getTagId() const { return _tagId; }
+
+    // a void tag of the BBTagSchema, which closed as soon as it opened
+    bool isVoid() const { return _void; }
+
+    void setOrAddParameter(const std::string& key, const std::string& value, bool addIfNotExists = true)
+    {
+        _parameters.insert({key,value});
+    }
+
+    std::string getParameter(const std::string& key, bool bDoThrow = true)
+    {
+        std::string_view value;
+        if (!findParameter(key, value))
+        {
+            if (bDoThrow)
+            {
+                BBCPP_THROW(std::invalid_argument("Undefine attribute '" + key + "'"));
+            }
+            return std::string();
+        }
+
+        return std::string(value);
+    }
+
+    // false instead of throwing when there is no parameter named `key`
+    bool findParameter(const std::string& key, std::string_view& value) const noexcept
+    {
+        const auto found = _parameters.find(key);
+        if (found == _parameters.end())
+        {
+            return false;
+        }
+
+        value = found->second;
+        return true;
+    }
+
+    const ParameterMap& getParameters() const { return _parameters; }
+
+    // the value of a VALUE element, "Bob;1234" for [quote=Bob;1234]
+    const std::string& getValue() const { return _value; }
+
+    // The ';' separated fields of the value, found when asked for: "Bob" and
+    // "1234" above. A value without a ';' is a single field.
+    std::size_t getValueFieldCount() const
+    {
+        return _value.empty() ? 0 : static_cast<std::size_t>(std::count(_value.begin(), _value.end(), ';')) + 1;
+    }
+
+    std::string_view getValueField(std::size_t index) const
+    {
+        std::string_view field;
+        if (!findValueField(index, field))
+        {
+            BBCPP_THROW(std::out_of_range("Value has no field " + std::to_string(index)));
+        }
+
+        return field;
+    }
+
+    // false instead of throwing when the value has no field `index`
+    bool findValueField(std::size_t index, std::string_view& field) const noexcept
+    {
+        std::string_view rest = _value;
+        for (; index > 0; index--)
+        {
+            const auto separator = rest.find(';');
+            if (separator == std::string_view::npos)
+            {
+                return false;
+            }
+            rest.remove_prefix(separator + 1);
+        }
+
+        field = rest.substr(0, rest.find(';'));
+        return true;
+    }
+
+    // The value read as a color, [color=red] or [color=#ff0000], as an
+    // integer from its last field, [size=12] or the post id of
+    // [quote=Bob;1234], or as a URL, [url=http://x.org]. Each is decoded on
+    // the first call and kept, so renderers can ask on every render. Not
+    // safe to call from several threads at once for one element.
+    bool getColor(std::uint32_t& rgba) const
+    {
+        if (!decoded(COLOR, [this] { return DecodeColor(_value, _color); }))
+        {
+            return false;
+        }
+
+        rgba = _color;
+        return true;
+    }
+
+    bool getInteger(std::int64_t& value) const
+    {
+        if (!decoded(INTEGER, [this] { return DecodeInteger(std::string_view(_value).substr(_value.rfind(';') + 1), _integer); }))
+        {
+            return false;
+        }
+
+        value = _integer;
+        return true;
+    }
+
+    bool getUrl(std::string_view& url) const
+    {
+        const auto valid = decoded(URL, [this]
+        {
+            std::string_view found;
+            if (!DecodeUrl(_value, found))
+            {
+                return false;
+            }
+
+            _urlBegin = static_cast<std::uint32_t>(found.data() - _value.data());
+            _urlLength = static_cast<std::uint32_t>(found.size());
+            return true;
+        });
+
+        if (!valid)
+        {
+            return false;
+        }
+
+        url = std::string_view(_value).substr(_urlBegin, _urlLength);
+        return true;
+    }
+
+private:
+    enum Decoded : std::uint8_t
+    {
+        COLOR = 1,
+        INTEGER = 2,
+        URL = 4
+    };
+
+    ElementType       _elementType = BBElement::SIMPLE;
+    BBTagId           _tagId = BBTag::NONE;
+    bool              _void = false;
+    mutable std::uint8_t    _decoded = 0;   // Decoded bits already tried
+    mutable std::uint8_t    _valid = 0;     // and the ones that succeeded
+    mutable std::uint32_t   _color = 0;
+    mutable std::uint32_t   _urlBegin = 0;
+    mutable std::uint32_t   _urlLength = 0;
+    mutable std::int64_t    _integer = 0;
+    std::string       _value;
+    ParameterMap      _parameters;
+
+    template<typename DecodeT>
+    bool decoded(Decoded kind, DecodeT decode) const
+    {
+        if ((_decoded & kind) == 0)
+        {
+            _decoded |= kind;
+            _valid |= decode() ? kind : 0;
+        }
+        return (_valid & kind) != 0;
+    }
+
+    friend class BBDocument;
+};
+
+class BBDocument : public BBNode
+{
+    BBDocument()
+        : BBNode(BBNode::NodeType::DOCUMENT, "#document")
+    {
+        // nothing to do
+    }
+
+public:
+    // node offsets are 32 bits, so everything loaded stays below 4 GB
+    static constexpr std::size_t MaxSourceSize = std::numeric_limits<std::uint32_t>::max();
+
+    static BBDocumentPtr create()
+    {
+        BBDocumentPtr doc = BBDocumentPtr(new BBDocument());
+        return doc;
     }
 
     void load(const std::string& bbcode)
     {
-        load(bbcode.begin(), bbcode.end());
+        load(bbcode, defaultOptions());
+    }
+
+    void load(const std::string& bbcode, const ParseOptions& options)
+    {
+        NullParseMetrics metrics;
+        NullParseTrace trace;
+        load(bbcode, options, metrics, trace);
+    }
+
+    // same as load(bbcode), and describes the work done in `metrics`
+    void load(const std::string& bbcode, ParseMetrics& metrics)
+    {
+        NullParseTrace trace;
+        load(bbcode, defaultOptions(), metrics, trace);
+    }
+
+    // same as load(bbcode), with any metrics and trace policy; pass a
+    // NullParseMetrics with a ParseTrace to time the phases only
+    template<typename MetricsT, typename TraceT>
+    void load(const std::string& bbcode, MetricsT& metrics, TraceT& trace)
+    {
+        load(bbcode, defaultOptions(), metrics, trace);
+    }
+
+    template<typename MetricsT, typename TraceT>
+    void load(const std::string& bbcode, const ParseOptions& options, MetricsT& metrics, TraceT& trace)
+    {
+        metrics = MetricsT();
+        _options = options;
+
+        const auto offset = appendSource(bbcode);
+        const auto end = _source.data() + _source.size();
+        parse(_source.data() + offset, end, end, 0, options, metrics, trace);
     }
 
     template<class Iterator>
     void load(Iterator begin, Iterator end)
     {
-        std::string buffer;
-        auto bUnknownNodeType = true;
-        auto current = begin;
-        auto nodeType = BBNode::NodeType::TEXT;
+        // the tokenizer works on contiguous memory
+        const std::string bbcode(begin, end);
+        load(bbcode);
+    }
+
+    // load() without exceptions: SOURCE_TOO_LARGE leaves the document as it
+    // was, TRUNCATED means a ParseLimits cap stopped this load. Running out of
+    // memory still ends the process, as it does in a build without exceptions.
+    BBStatus tryLoad(const std::string& bbcode, const ParseOptions& options = defaultOptions()) noexcept;
+
+    const BBDocumentStats& getStats() const { return _stats; }
+
+    // The id of a tag name in any case: its BBTag value for the common tags,
+    // or the id this document gave it when it was first parsed. NONE for
+    // names the document has not seen.
+    BBTagId getTagId(std::string_view name) const
+    {
+        const auto id = BBTag::find(name);
+        if (id != BBTag::NONE)
+        {
+            return id;
+        }
+
+        const auto index = _tags.find(name);
+        return index == BBTagTable::npos ? BBTag::NONE : static_cast<BBTagId>(BBTag::COUNT + index);
+    }
+
+    // the spelling a tag id was first seen with, lower case for the common tags
+    std::string_view getTagName(BBTagId id) const
+    {
+        return id < BBTag::COUNT ? BBTag::Names[id] : std::string_view(_tags.getName(id - BBTag::COUNT));
+    }
+
+    // everything passed to load(), with the edits made by applyEdit()
+    const std::string& getSource() const { return _source; }
+
+    // the original markup of a span, e.g. getSource(node->getSourceSpan())
+    std::string_view getSource(const BBSourceSpan& span) const
+    {
+        return std::string_view(_source).substr(span.begin, span.size());
+    }
+
+    // Replaces `removedLength` bytes of the source at `offset` with
+    // `inserted` and updates the tree to match a fresh load() of the new
+    // source. Only the children of the deepest element that holds the
+    // changed tokens are parsed again; the other nodes are kept, and the ones
+    // after the edit have their source offsets moved. When the new markup
+    // opens or closes tags across that element's boundary, or the document
+    // was loaded with ParseLimits, the whole source is parsed again instead.
+    // Returns false if that happened.
+    bool applyEdit(std::size_t offset, std::size_t removedLength, const std::string& inserted);
+
+    // applyEdit() without exceptions, `incremental` gets its result when the
+    // edit is made
+    BBStatus tryApplyEdit(std::size_t offset, std::size_t removedLength, const std::string& inserted,
+        bool& incremental) noexcept;
+
+    // an immutable copy that threads can read concurrently, see BBFrozenDocument.h
+    BBFrozenDocumentPtr freeze() const;
+
+    // the frozen copy in the binary format of BBFrozenDocument::serialize(),
+    // read back with BBFrozenDocument::deserialize()
+    std::string serialize() const;
+
+private:
+    BBNodeStack         _stack;
+    BBDocumentStats     _stats;
+    std::string         _source;
+    ParseOptions        _options;
+    BBTagTable          _tags;      // names outside BBTag, id - BBTag::COUNT
+    std::vector<std::size_t> _depthCounts;  // elements at each depth, keeps maxDepth exact across edits
+    std::vector<std::uint32_t> _openCounts; // elements of each tag id on _stack
+
+    // Opening tags that ParseLimits kept as text, with the stack size and
+    // the open elements of their tag at that point. Each takes the closer
+    // that would have closed it, and is dropped when its parent closes.
+    struct RefusedTag
+    {
+        BBTagId         tagId;
+        std::uint32_t   openCount;
+        std::size_t     depth;
+        std::size_t     count;      // the same tag refused again right after
+        std::size_t     previous;   // index + 1 of the one before of the same tag, 0 for none
+    };
+
+    std::vector<RefusedTag> _refused;
+    std::vector<std::size_t> _lastRefused;  // index + 1 of the innermost entry of each tag id, 0 for none
+
+    // Parses the tokens of [begin, end) that start before `stopAt`, all of
+    // them inside _source. Returns false without consuming it if a closing
+    // tag would close one of the `baseDepth` elements already open (never for
+    // 0).
+    template<typename MetricsT, typename TraceT>
+    bool parse(const char* begin, const char* stopAt, const char* end, std::size_t baseDepth,
+        const ParseOptions& options, MetricsT& metrics, TraceT& trace);
+    void countElement(BBTagId tagId);
+    std::string histogramKey(BBTagId tagId) const;
+    BBTextPtr mergeTarget() const;
+    BBTagId internTag(const BBToken& token);
+    BBTagId internTag(std::string_view name);
+    BBTagId findOpenTag(const BBToken& token) const;
+    void refuseTag(BBTagId id);
+    bool closeRefusedTag(const BBToken& token);
+    void popRefusedTag();
+
+    // ParseOptions::rawTags and the schema by tag id
+    struct TagRule
+    {
+        bool                    raw = false;
+        bool                    isVoid = false;
+        bool                    voidWithValue = false;
+        std::vector<BBTagId>    closes;
+        std::vector<BBTagId>    parents;
+    };
+
+    std::vector<TagRule> _rules;    // resolved for options other than the defaults
+
+    // the options of load(bbcode), built once so plain loads do not allocate them
+    static const ParseOptions& defaultOptions()
+    {
+        static const ParseOptions options;
+        return options;
+    }
+
+    // the default options only name BBTag tags, so one table serves every document
+    const std::vector<TagRule>& resolveRules(const ParseOptions& options);
+
+    template<typename InternT>
+    static void resolveRules(const ParseOptions& options, InternT intern, std::vector<TagRule>& rules);
+
+    void pushElement(const BBNodePtr& element);
+    void popElement(std::uint32_t contentEnd, std::uint32_t end);
+    void clearStack();
+
+    std::size_t appendSource(const std::string& bbcode);
+    BBStatus checkEdit(std::size_t offset, std::size_t removedLength, std::size_t insertedLength) const noexcept;
+    void reparse();
+    void rebuildStack();
+
+    BBText& newText(const std::string& text, std::uint32_t begin, std::uint32_t end);
+    BBElement& newElement(const std::string& name, BBTagId tagId, std::uint32_t begin, std::uint32_t end);
+    BBElement& newClosingElement(const std::string& name, BBTagId tagId, std::uint32_t begin, std::uint32_t end);
+    BBElement& newValueElement(const std::string& name, BBTagId tagId, std::string value,
+        std::uint32_t begin, std::uint32_t end);
+
+    BBElement& newKeyValueElement(const std::string& name, BBTagId tagId, const ParameterMap& pairs,
+        std::uint32_t begin, std::uint32_t end);
+};
+
+template<typename MetricsT, typename TraceT>
+bool BBDocument::parse(const char* begin, const char* stopAt, const char* end, std::size_t baseDepth,
+    const ParseOptions& options, MetricsT& metrics, TraceT& trace)
+{
+    BBTokenizer tokenizer(begin, end, options.strictAttributes);
+    BBToken token;
+
+    // elements opened here that are still open at the end are found by
+    // following last children down from `root`
+    BBNode* const root = baseDepth == 0 ? this : _stack.top().get();
+    auto parsedEnd = static_cast<std::uint32_t>(begin - _source.data());
+    bool balanced = true;
+
+    // the elements open below `baseDepth`, a closer that would match one of
+    // them instead of an element opened here ends the parse
+    const auto baseCounts = baseDepth > 0 ? _openCounts : std::vector<std::uint32_t>();
+
+    const auto& limits = options.limits;
+    std::size_t nodes = 0;
+    std::size_t textLength = 0;
+    std::size_t parameters = 0;
+
+    const auto& rules = resolveRules(options);
+    const auto ruleFor = [&rules](BBTagId id) { return id < rules.size() ? &rules[id] : nullptr; };
+    const auto isRaw = [&ruleFor](BBTagId id) { const auto rule = ruleFor(id); return rule && rule->raw; };
+    const auto isVoid = [](const TagRule* rule, const BBToken& token) { return rule && (rule->isVoid || (rule->voidWithValue && token.hasValue())); };
+    const auto topTag = [this]() { return static_cast<const BBElement&>(*_stack.top()).getTagId(); };
+
+    // right after a raw element opens, everything up to its closing tag is
+    // one text token
+    bool inRaw = !_stack.empty() && isRaw(topTag());
+    bool rawText = false;
+
+    const auto nextToken = [&]()
+    {
+        ParseTraceScope<TraceT> scope(trace, ParsePhase::TOKENIZE);
+
+        rawText = inRaw;
+        if (inRaw)
+        {
+            inRaw = false;
+
+            const auto current = begin + tokenizer.position();
+            const auto closer = BBTokenizer::findClosingTag(current, end, getTagName(topTag()));
+            const auto contentEnd = closer != nullptr ? closer : end;
+
+            if (contentEnd != current)
+            {
+                token = BBToken{};
+                token.type = BBToken::Type::TEXT;
+                token.source = std::string_view(current, static_cast<std::size_t>(contentEnd - current));
+                tokenizer.setPosition(static_cast<std::size_t>(contentEnd - begin));
+                return true;
+            }
+            rawText = false;
+        }
+
+        return tokenizer.next(token);
+    };
+
+    if constexpr (MetricsT::enabled)
+    {
+        metrics.bytesScanned += static_cast<std::size_t>(end - begin);
+    }
 
-        Iterator temp;
+    while (nextToken())
+    {
+        bool stop = false;
+
+        if (token.source.data() >= stopAt)
+        {
+            break;
+        }
+
+        // raw content is the only token that can run past `stopAt`, into
+        // nodes the caller keeps
+        if (token.source.data() + token.source.size() > stopAt)
+        {
+            balanced = false;
+            break;
+        }
+
+        if (nodes + 1 >= limits.maxNodes)
+        {
+            if (nodes >= limits.maxNodes)
+            {
+                _stats.truncated = true;
+                break;
+            }
 
-        while (current != end)
+            // the last node allowed takes the rest of the input as text
+            token.type = BBToken::Type::TEXT;
+            token.source = std::string_view(token.source.data(), static_cast<std::size_t>(end - token.source.data()));
+            stop = true;
+
+            if (tokenizer.position() < static_cast<std::size_t>(end - begin))
+            {
+                _stats.truncated = true;
+            }
+        }
+        else if (token.type == BBToken::Type::ELEMENT
+            && (token.name.size() > limits.maxTagNameLength
+                || _stack.size() >= limits.maxDepth
+                || (token.hasParameter() && token.parameterCount > limits.maxParameters - parameters)))
         {
-            if (bUnknownNodeType)
+            // the closer of a name that is too long is too long as well
+            if (token.name.size() <= limits.maxTagNameLength)
             {
-                if (*current == '[')
+                const auto id = internTag(token);
+                if (!isVoid(ruleFor(id), token))
                 {
-                    nodeType = BBNode::NodeType::ELEMENT;
-                    bUnknownNodeType = false;
+                    refuseTag(id);
                 }
-                else
+            }
+
+            token.type = BBToken::Type::TEXT;
+            _stats.degradedTags++;
+        }
+        else if (token.type == BBToken::Type::CLOSING
+            && (token.name.size() > limits.maxTagNameLength || (!_refused.empty() && closeRefusedTag(token))))
+        {
+            token.type = BBToken::Type::TEXT;
+            _stats.degradedTags++;
+        }
+
+        BBTagId closingId = BBTag::NONE;
+        if (token.type == BBToken::Type::CLOSING)
+        {
+            // a closer with no open element of its name is kept as text
+            closingId = findOpenTag(token);
+            if (closingId == BBTag::NONE)
+            {
+                token.type = BBToken::Type::TEXT;
+            }
+        }
+
+        BBTagId tagId = BBTag::NONE;
+        const TagRule* rule = nullptr;
+        if (token.type == BBToken::Type::ELEMENT)
+        {
+            tagId = internTag(token);
+            rule = ruleFor(tagId);
+        }
+
+        const auto contains = [](const std::vector<BBTagId>& ids, BBTagId id) { return std::find(ids.begin(), ids.end(), id) != ids.end(); };
+        const auto openAbove = [this](BBTagId id, const std::vector<std::uint32_t>& counts)
+        {
+            return id < _openCounts.size() && _openCounts[id] > (id < counts.size() ? counts[id] : 0);
+        };
+
+        if (rule && std::any_of(rule->closes.begin(), rule->closes.end(), [&](BBTagId id) { return openAbove(id, {}); }))
+        {
+            // the pops below stop at the innermost sibling or parent; when
+            // that one belongs to the nodes the caller keeps, so does the change
+            if (baseDepth > 0
+                && std::none_of(rule->closes.begin(), rule->closes.end(), [&](BBTagId id) { return openAbove(id, baseCounts); })
+                && std::none_of(rule->parents.begin(), rule->parents.end(), [&](BBTagId id) { return openAbove(id, baseCounts); }))
+            {
+                balanced = false;
+                break;
+            }
+
+            // close the open sibling and whatever was left open inside it,
+            // unless a parent comes first: then the sibling is in an outer list
+            const auto position = static_cast<std::uint32_t>(token.source.data() - _source.data());
+            while (!_stack.empty() && !contains(rule->parents, topTag()))
+            {
+                const auto sibling = contains(rule->closes, topTag());
+                popElement(position, position);
+                if (sibling)
                 {
-                    nodeType = BBNode::NodeType::TEXT;
-                    bUnknownNodeType = false;
+                    break;
                 }
             }
+        }
+
+        if (rule && !rule->parents.empty()
+            && (_stack.empty() || !contains(rule->parents, topTag())))
+        {
+            token.type = BBToken::Type::TEXT;
+        }
+
+        if (token.type == BBToken::Type::TEXT && token.source.size() > limits.maxTextLength - textLength)
+        {
+            token.source = token.source.substr(0, limits.maxTextLength - textLength);
+            _stats.truncated = true;
+            stop = true;
+
+            if (token.source.empty())
+            {
+                break;
+            }
+        }
+
+        if (token.type == BBToken::Type::CLOSING && baseDepth > 0
+            && _openCounts[closingId] == (closingId < baseCounts.size() ? baseCounts[closingId] : 0))
+        {
+            balanced = false;
+            break;
+        }
+
+        const auto tokenBegin = static_cast<std::uint32_t>(token.source.data() - _source.data());
+        const auto tokenEnd = static_cast<std::uint32_t>(tokenBegin + token.source.size());
+        const auto textNodesBefore = _stats.textNodeCount;
+
+        BBNode* parent = nullptr;
+        BBTextPtr tail;
+        std::size_t childCapacity = 0;
+        std::size_t tailCapacity = 0;
+
+        if constexpr (MetricsT::enabled)
+        {
+            parent = _stack.empty() ? this : _stack.top().get();
+            childCapacity = parent->_children.capacity();
+
+            if (token.type == BBToken::Type::TEXT && (tail = mergeTarget()))
+            {
+                tailCapacity = tail->_name.capacity();
+            }
+        }
+
+        switch (token.type)
+        {
+            case BBToken::Type::END:
+                // nextToken() returns false instead
+            break;
+
+            case BBToken::Type::TEXT:
+            {
+                ParseTraceScope<TraceT> scope(trace, ParsePhase::NODES);
+                newText(std::string(token.source), tokenBegin, tokenEnd);
+            }
+            break;
 
-            if (!bUnknownNodeType)
+            case BBToken::Type::ELEMENT:
             {
-                switch (nodeType)
+                BBElement* element = nullptr;
+                inRaw = isRaw(tagId);
+
+                if (token.hasValue())
                 {
-                    default:
-                        throw std::runtime_error("Unknown node type in BBDocument::load()");
-                    break;
+                    ParseTraceScope<TraceT> scope(trace, ParsePhase::NODES);
+                    element = &newValueElement(std::string(token.name), tagId, UnescapeValue(token.value), tokenBegin, tokenEnd);
+                }
+                else if (token.hasParameter())
+                {
+                    ParameterMap pairs;
+                    {
+                        ParseTraceScope<TraceT> scope(trace, ParsePhase::PARAMETERS);
+                        BBAttributeLexer attributes(token.attributes);
+                        for (std::string_view key, value; attributes.next(key, value);)
+                        {
+                            pairs.emplace(std::string(key), UnescapeValue(value));
+                        }
+                    }
+
+                    ParseTraceScope<TraceT> scope(trace, ParsePhase::NODES);
+                    element = &newKeyValueElement(std::string(token.name), tagId, pairs, tokenBegin, tokenEnd);
+                }
+                else
+                {
+                    ParseTraceScope<TraceT> scope(trace, ParsePhase::NODES);
+                    element = &newElement(std::string(token.name), tagId, tokenBegin, tokenEnd);
+                }
 
-                    case BBNode::NodeType::TEXT:
+                if (isVoid(rule, token))
+                {
+                    element->_void = true;
+                    popElement(tokenEnd, tokenEnd);
+                    inRaw = false;
+                }
+            }
+            break;
+
+            case BBToken::Type::CLOSING:
+            {
+                ParseTraceScope<TraceT> scope(trace, ParsePhase::FIXUP);
+                newClosingElement(std::string(token.name), closingId, tokenBegin, tokenEnd);
+            }
+            break;
+        }
+
+        if constexpr (MetricsT::enabled)
+        {
+            // strings up to this size live inside the string object itself;
+            // every token is copied into a temporary before the node takes
+            // its own copy, so each long string costs two allocations
+            static const std::size_t inlineCapacity = std::string().capacity();
+            const auto heapString = [](std::string_view str) { return str.size() > inlineCapacity ? 2u : 0u; };
+
+            switch (token.type)
+            {
+                case BBToken::Type::TEXT:
+                    if (token.source.front() == '[' && !rawText)
                     {
-                        current = parseText(current, end);
-                        bUnknownNodeType = true;
+                        metrics.failedTags++;
                     }
-                    break;
 
-                    case BBNode::NodeType::ELEMENT:
+                    if (tail)
                     {
-                        temp  = parseElement(current, end);
-                        if (temp == current)
-                        {
-                            // nothing was parsed, treat as text
-                            nodeType = BBNode::NodeType::TEXT;
-                            bUnknownNodeType = false;
-                        }
-                        else
+                        metrics.textMerges++;
+                        metrics.allocations += heapString(token.source) / 2 + (tail->_name.capacity() != tailCapacity ? 1 : 0);
+                    }
+                    else
+                    {
+                        metrics.textNodes++;
+                        metrics.allocations += 1 + heapString(token.source);
+                    }
+                break;
+
+                case BBToken::Type::ELEMENT:
+                    metrics.elementNodes++;
+                    metrics.allocations += 1 + heapString(token.name);
+                    if (token.hasValue())
+                    {
+                        // copied straight from the input, no temporary
+                        metrics.allocations += heapString(token.value) / 2;
+                    }
+                    else if (token.hasParameter())
+                    {
+                        BBAttributeLexer attributes(token.attributes);
+                        for (std::string_view key, value; attributes.next(key, value);)
                         {
-                            current = temp;
-                            bUnknownNodeType = true;
+                            metrics.allocations += 2 + heapString(key) + heapString(value);
                         }
                     }
-                    break;
-                }
+                break;
+
+                case BBToken::Type::CLOSING:
+                    metrics.closingNodes++;
+                    metrics.allocations += 1 + heapString(token.name);
+                break;
+
+                default:
+                break;
+            }
+
+            if (parent->_children.capacity() != childCapacity)
+            {
+                metrics.allocations++;
             }
+
+            metrics.maxDepth = std::max(metrics.maxDepth, _stack.size());
+        }
+
+        parsedEnd = tokenEnd;
+
+        if (token.type == BBToken::Type::TEXT)
+        {
+            nodes += _stats.textNodeCount - textNodesBefore;
+            textLength += token.source.size();
+        }
+        else
+        {
+            nodes++;
+            parameters += token.parameterCount;
+        }
+
+        if (stop)
+        {
+            break;
         }
     }
 
-private:
-    BBNodeStack     _stack;
+    // unclosed elements end where parsing stopped
+    auto node = root;
+    for (auto open = _stack.size(); open > baseDepth && !node->_children.empty(); open--)
+    {
+        node = node->_children.back().get();
+        node->_contentEnd = parsedEnd;
+        node->_sourceEnd = parsedEnd;
+    }
 
-    BBText& newText(const std::string& text = std::string());
-    BBElement& newElement(const std::string& name);
-    BBElement& newClosingElement(const std::string& name);
-    BBElement& newKeyValueElement(const std::string& name, const ParameterMap& pairs);
-};
+    return balanced;
+}
 
 namespace
 {
@@ -0,0 +1,405 @@
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "BBFrozenDocument.h"
+#include "bbcpputils.h"
+
+namespace bbcpp
+{
+
+namespace
+{
+
+std::uint32_t checkedSize(std::size_t size)
+{
+    if (size >= BBFrozenDocument::npos)
+    {
+        BBCPP_THROW(std::length_error("Document is too large to freeze"));
+    }
+    return static_cast<std::uint32_t>(size);
+}
+
+const char Magic[4] = { 'B', 'B', 'C', 'F' };
+
+bool hostIsLittleEndian()
+{
+    const std::uint32_t one = 1;
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+void put16(std::string& output, std::uint16_t value)
+{
+    output += static_cast<char>(value & 0xff);
+    output += static_cast<char>(value >> 8);
+}
+
+void put32(std::string& output, std::uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        output += static_cast<char>((value >> shift) & 0xff);
+    }
+}
+
+std::uint16_t get16(const unsigned char* data)
+{
+    return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+}
+
+std::uint32_t get32(const unsigned char* data)
+{
+    return static_cast<std::uint32_t>(data[0])
+        | (static_cast<std::uint32_t>(data[1]) << 8)
+        | (static_cast<std::uint32_t>(data[2]) << 16)
+        | (static_cast<std::uint32_t>(data[3]) << 24);
+}
+
+bool inRange(std::uint64_t offset, std::uint64_t length, std::uint64_t size)
+{
+    return offset <= size && length <= size - offset;
+}
+
+}
+
+BBFrozenDocument::BBFrozenDocument(const BBDocument& document)
+{
+    const auto& stats = document.getStats();
+    _nodes.reserve(1 + stats.elementCount + stats.closingCount + stats.textNodeCount);
+    _strings.reserve(stats.textLength);
+
+    // element names repeat, so each one is stored once
+    std::unordered_map<std::string, std::uint32_t> names;
+    const auto addString = [this](const std::string& str)
+    {
+        const auto offset = checkedSize(_strings.size());
+        _strings += str;
+        checkedSize(_strings.size());
+        return offset;
+    };
+
+    Node root{};
+    root.type = static_cast<std::uint8_t>(BBNode::NodeType::DOCUMENT);
+    root.parent = npos;
+    root.nextSibling = npos;
+    root.nameOffset = addString(document.getNodeName());
+    root.nameLength = static_cast<std::uint32_t>(document.getNodeName().size());
+    _nodes.push_back(root);
+
+    // open[d] is the node at depth d - 1 whose children are being added,
+    // last[d] the most recent of those children
+    std::vector<Index> open{ 0 };
+    std::vector<Index> last{ npos };
+
+    traverse(document,
+        [&](const BBNode& node, std::size_t depth)
+        {
+            const auto index = checkedSize(_nodes.size());
+            const auto parent = open[depth];
+
+            Node row{};
+            row.type = static_cast<std::uint8_t>(node.getNodeType());
+            row.parent = parent;
+            row.nextSibling = npos;
+            row.nameLength = checkedSize(node.getNodeName().size());
+
+            if (node.getNodeType() == BBNode::NodeType::ELEMENT)
+            {
+                const auto& element = static_cast<const BBElement&>(node);
+                row.elementType = static_cast<std::uint8_t>(element.getElementType());
+
+                auto name = names.find(element.getNodeName());
+                if (name == names.end())
+                {
+                    name = names.emplace(element.getNodeName(), addString(element.getNodeName())).first;
+                }
+                row.nameOffset = name->second;
+
+                row.parameterBegin = checkedSize(_parameters.size());
+                row.parameterCount = checkedSize(element.getParameters().size());
+                if (element.getElementType() == BBElement::VALUE)
+                {
+                    Parameter parameter{};
+                    parameter.valueOffset = addString(element.getValue());
+                    parameter.valueLength = static_cast<std::uint32_t>(element.getValue().size());
+                    _parameters.push_back(parameter);
+                    row.parameterCount = 1;
+                }
+
+                for (const auto& kv : element.getParameters())
+                {
+                    Parameter parameter{};
+                    parameter.keyOffset = addString(kv.first);
+                    parameter.keyLength = static_cast<std::uint32_t>(kv.first.size());
+                    parameter.valueOffset = addString(kv.second);
+                    parameter.valueLength = static_cast<std::uint32_t>(kv.second.size());
+                    _parameters.push_back(parameter);
+                }
+            }
+            else
+            {
+                row.nameOffset = addString(node.getNodeName());
+            }
+
+            if (last[depth] != npos)
+            {
+                _nodes[last[depth]].nextSibling = index;
+            }
+            last[depth] = index;
+            _nodes[parent].childCount++;
+            _nodes.push_back(row);
+
+            open.resize(depth + 1);
+            last.resize(depth + 1);
+            open.push_back(index);
+            last.push_back(npos);
+
+            return VisitResult::CONTINUE;
+        },
+        [&](const BBNode&, std::size_t depth)
+        {
+            // everything added since the node was entered is a descendant
+            _nodes[open[depth + 1]].end = static_cast<Index>(_nodes.size());
+            return VisitResult::CONTINUE;
+        });
+
+    _nodes[0].end = static_cast<Index>(_nodes.size());
+    attachOwned();
+}
+
+void BBFrozenDocument::attachOwned()
+{
+    _nodeData = _nodes.data();
+    _parameterData = _parameters.data();
+    _stringData = _strings.data();
+    _nodeCount = _nodes.size();
+    _parameterCount = _parameters.size();
+    _stringLength = _strings.size();
+}
+
+std::string BBFrozenDocument::serialize() const
+{
+    std::string output;
+    serialize(output);
+    return output;
+}
+
+void BBFrozenDocument::serialize(std::string& output) const
+{
+    output.clear();
+    output.reserve(HeaderSize + _nodeCount * sizeof(Node) + _parameterCount * sizeof(Parameter) + _stringLength);
+
+    output.append(Magic, sizeof(Magic));
+    put16(output, FormatVersion);
+    put16(output, 0);
+    put32(output, static_cast<std::uint32_t>(_nodeCount));
+    put32(output, static_cast<std::uint32_t>(_parameterCount));
+    put32(output, static_cast<std::uint32_t>(_stringLength));
+
+    for (std::size_t i = 0; i < _nodeCount; i++)
+    {
+        const auto& node = _nodeData[i];
+        output += static_cast<char>(node.type);
+        output += static_cast<char>(node.elementType);
+        put16(output, 0);
+        put32(output, node.parent);
+        put32(output, node.nextSibling);
+        put32(output, node.end);
+        put32(output, node.childCount);
+        put32(output, node.nameOffset);
+        put32(output, node.nameLength);
+        put32(output, node.parameterBegin);
+        put32(output, node.parameterCount);
+    }
+
+    for (std::size_t i = 0; i < _parameterCount; i++)
+    {
+        const auto& parameter = _parameterData[i];
+        put32(output, parameter.keyOffset);
+        put32(output, parameter.keyLength);
+        put32(output, parameter.valueOffset);
+        put32(output, parameter.valueLength);
+    }
+
+    output.append(_stringData, _stringLength);
+}
+
+BBFrozenDocumentPtr BBFrozenDocument::deserialize(const void* data, std::size_t size)
+{
+    const char* error = nullptr;
+    auto document = read(data, size, error);
+    if (!document)
+    {
+        BBCPP_THROW(std::invalid_argument(std::string("Not a serialized BBFrozenDocument: ") + error));
+    }
+
+    return document;
+}
+
+BBStatus BBFrozenDocument::tryDeserialize(const void* data, std::size_t size, BBFrozenDocumentPtr& document) noexcept
+{
+    const char* error = nullptr;
+    auto found = read(data, size, error);
+    if (!found)
+    {
+        return BBStatus::INVALID_FORMAT;
+    }
+
+    document = std::move(found);
+    return BBStatus::OK;
+}
+
+BBFrozenDocumentPtr BBFrozenDocument::read(const void* data, std::size_t size, const char*& error)
+{
+    const auto bytes = static_cast<const unsigned char*>(data);
+    if (size < HeaderSize)
+    {
+        error = "too short";
+        return nullptr;
+    }
+    if (std::memcmp(bytes, Magic, sizeof(Magic)) != 0)
+    {
+        error = "bad magic";
+        return nullptr;
+    }
+    if (get16(bytes + 4) != FormatVersion || get16(bytes + 6) != 0)
+    {
+        error = "unsupported version";
+        return nullptr;
+    }
+
+    const std::uint64_t nodeCount = get32(bytes + 8);
+    const std::uint64_t parameterCount = get32(bytes + 12);
+    const std::uint64_t stringLength = get32(bytes + 16);
+    if (nodeCount == 0 || HeaderSize + nodeCount * sizeof(Node) + parameterCount * sizeof(Parameter) + stringLength != size)
+    {
+        error = "sizes do not match";
+        return nullptr;
+    }
+
+    const auto nodeBytes = bytes + HeaderSize;
+    const auto parameterBytes = nodeBytes + nodeCount * sizeof(Node);
+    const auto stringBytes = parameterBytes + parameterCount * sizeof(Parameter);
+
+    std::shared_ptr<BBFrozenDocument> doc(new BBFrozenDocument());
+    auto& frozen = *doc;
+
+    if (hostIsLittleEndian() && reinterpret_cast<std::uintptr_t>(bytes) % alignof(Node) == 0)
+    {
+        // the layout in the buffer is the layout in memory
+        frozen._nodeData = reinterpret_cast<const Node*>(nodeBytes);
+        frozen._parameterData = reinterpret_cast<const Parameter*>(parameterBytes);
+        frozen._stringData = reinterpret_cast<const char*>(stringBytes);
+        frozen._nodeCount = nodeCount;
+        frozen._parameterCount = parameterCount;
+        frozen._stringLength = stringLength;
+    }
+    else
+    {
+        frozen._nodes.resize(nodeCount);
+        for (std::size_t i = 0; i < nodeCount; i++)
+        {
+            const auto row = nodeBytes + i * sizeof(Node);
+            auto& node = frozen._nodes[i];
+            node.type = row[0];
+            node.elementType = row[1];
+            node.reserved = 0;
+            node.parent = get32(row + 4);
+            node.nextSibling = get32(row + 8);
+            node.end = get32(row + 12);
+            node.childCount = get32(row + 16);
+            node.nameOffset = get32(row + 20);
+            node.nameLength = get32(row + 24);
+            node.parameterBegin = get32(row + 28);
+            node.parameterCount = get32(row + 32);
+        }
+
+        frozen._parameters.resize(parameterCount);
+        for (std::size_t i = 0; i < parameterCount; i++)
+        {
+            const auto row = parameterBytes + i * sizeof(Parameter);
+            auto& parameter = frozen._parameters[i];
+            parameter.keyOffset = get32(row);
+            parameter.keyLength = get32(row + 4);
+            parameter.valueOffset = get32(row + 8);
+            parameter.valueLength = get32(row + 12);
+        }
+
+        frozen._strings.assign(reinterpret_cast<const char*>(stringBytes), stringLength);
+        frozen.attachOwned();
+    }
+
+    error = frozen.validate();
+    return error == nullptr ? doc : nullptr;
+}
+
+const char* BBFrozenDocument::validate() const
+{
+    // buffers come from caches and files, so every index and span is checked
+    // once here and the accessors can stay unchecked
+    for (std::size_t i = 0; i < _nodeCount; i++)
+    {
+        const auto& node = _nodeData[i];
+        if (node.type > static_cast<std::uint8_t>(BBNode::NodeType::TEXT)
+            || (i == 0) != (node.type == static_cast<std::uint8_t>(BBNode::NodeType::DOCUMENT))
+            || node.elementType > BBElement::CLOSING)
+        {
+            return "bad node type";
+        }
+        if (i == 0 ? node.parent != npos : node.parent >= i)
+        {
+            return "bad parent";
+        }
+        if (node.end <= i || node.end > _nodeCount || (i == 0 && node.end != _nodeCount)
+            || (node.nextSibling != npos && (node.nextSibling <= i || node.nextSibling >= _nodeCount)))
+        {
+            return "bad node range";
+        }
+        if (!inRange(node.nameOffset, node.nameLength, _stringLength)
+            || !inRange(node.parameterBegin, node.parameterCount, _parameterCount))
+        {
+            return "bad span";
+        }
+    }
+
+    for (std::size_t i = 0; i < _parameterCount; i++)
+    {
+        const auto& parameter = _parameterData[i];
+        if (!inRange(parameter.keyOffset, parameter.keyLength, _stringLength)
+            || !inRange(parameter.valueOffset, parameter.valueLength, _stringLength))
+        {
+            return "bad span";
+        }
+    }
+
+    return nullptr;
+}
+
+bool BBFrozenDocument::findParameter(Index node, std::string_view key, std::string_view& value) const
+{
+    for (std::size_t i = 0; i < getParameterCount(node); i++)
+    {
+        const auto parameter = getParameter(node, i);
+        if (parameter.first == key)
+        {
+            value = parameter.second;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+BBFrozenDocumentPtr BBDocument::freeze() const
+{
+    return std::make_shared<const BBFrozenDocument>(*this);
+}
+
+std::string BBDocument::serialize() const
+{
+    return freeze()->serialize();
+}
+
+} // namespace
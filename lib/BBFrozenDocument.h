@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "BBDocument.h"
+
+namespace bbcpp
+{
+
+// An immutable copy of a BBDocument in a flat table, made by
+// BBDocument::freeze(). Nodes are stored in document order (pre-order) and
+// addressed by index, with the document itself at index 0; a node's
+// descendants are the indices in [node + 1, end(node)). All strings live in
+// one buffer and are returned as views into it.
+//
+// Nothing is reference counted and nothing changes after construction, so
+// any number of threads may read one frozen document at the same time
+// without locking. Share it through the BBFrozenDocumentPtr that freeze()
+// returns; the views it hands out live as long as the document.
+//
+// serialize() writes the same tables as a position-independent buffer:
+//
+//   header      "BBCF", uint16 version, uint16 flags (0),
+//               uint32 node count, uint32 parameter count, uint32 string bytes
+//   nodes       node count * Node
+//   parameters  parameter count * Parameter
+//   strings     string bytes
+//
+// Every integer is little-endian and every table starts on a 4 byte
+// boundary. deserialize() checks the buffer and, on a little-endian host
+// with a 4 byte aligned buffer, reads the tables where they are (an mmapped
+// file, a cache entry) without copying them or allocating per node.
+class BBFrozenDocument
+{
+public:
+    using Index = std::uint32_t;
+    static constexpr Index npos = static_cast<Index>(-1);
+
+    // one row of the node table, 36 bytes with no pointers
+    struct Node
+    {
+        std::uint8_t    type;           // BBNode::NodeType
+        std::uint8_t    elementType;    // BBElement::ElementType, elements only
+        std::uint16_t   reserved;
+        Index           parent;         // npos for the document
+        Index           nextSibling;    // npos for the last child
+        Index           end;            // one past the last descendant
+        Index           childCount;
+        std::uint32_t   nameOffset;     // element name or text content
+        std::uint32_t   nameLength;
+        std::uint32_t   parameterBegin;
+        std::uint32_t   parameterCount;
+    };
+
+    struct Parameter
+    {
+        std::uint32_t   keyOffset;
+        std::uint32_t   keyLength;
+        std::uint32_t   valueOffset;
+        std::uint32_t   valueLength;
+    };
+
+    static constexpr std::uint16_t FormatVersion = 1;
+    static constexpr std::size_t HeaderSize = 20;
+
+    explicit BBFrozenDocument(const BBDocument& document);
+
+    BBFrozenDocument(const BBFrozenDocument&) = delete;
+    BBFrozenDocument& operator=(const BBFrozenDocument&) = delete;
+
+    // Reads a buffer written by serialize(), throws std::invalid_argument if
+    // it is not one. When the tables can be used in place the result refers
+    // to `data`, which must outlive it.
+    static BBFrozenDocumentPtr deserialize(const void* data, std::size_t size);
+
+    // deserialize() without exceptions, INVALID_FORMAT if `data` is not a
+    // serialized document
+    static BBStatus tryDeserialize(const void* data, std::size_t size, BBFrozenDocumentPtr& document) noexcept;
+
+    std::string serialize() const;
+    void serialize(std::string& output) const;
+
+    // true if the tables are read from a buffer given to deserialize()
+    bool isView() const { return _nodes.empty(); }
+
+    std::size_t size() const { return _nodeCount; }
+
+    BBNode::NodeType getNodeType(Index node) const { return static_cast<BBNode::NodeType>(_nodeData[node].type); }
+    BBElement::ElementType getElementType(Index node) const { return static_cast<BBElement::ElementType>(_nodeData[node].elementType); }
+
+    // element name, or the content of a text node
+    std::string_view getNodeName(Index node) const { return view(_nodeData[node].nameOffset, _nodeData[node].nameLength); }
+
+    Index getParent(Index node) const { return _nodeData[node].parent; }
+    Index getFirstChild(Index node) const { return _nodeData[node].end > node + 1 ? node + 1 : npos; }
+    Index getNextSibling(Index node) const { return _nodeData[node].nextSibling; }
+    Index getEnd(Index node) const { return _nodeData[node].end; }
+    std::size_t getChildCount(Index node) const { return _nodeData[node].childCount; }
+
+    std::size_t getParameterCount(Index node) const { return _nodeData[node].parameterCount; }
+    std::pair<std::string_view, std::string_view> getParameter(Index node, std::size_t index) const
+    {
+        const auto& parameter = _parameterData[_nodeData[node].parameterBegin + index];
+        return { view(parameter.keyOffset, parameter.keyLength), view(parameter.valueOffset, parameter.valueLength) };
+    }
+
+    // finds the value of `key`, returns false if the element has no such parameter
+    bool findParameter(Index node, std::string_view key, std::string_view& value) const;
+
+    // the value of a VALUE element, kept as its only parameter with an empty key
+    std::string_view getValue(Index node) const
+    {
+        return getElementType(node) == BBElement::VALUE && getParameterCount(node) > 0 ? getParameter(node, 0).second : std::string_view();
+    }
+
+private:
+    // the tables, owned when built by freeze() and empty for a view
+    std::vector<Node>       _nodes;
+    std::vector<Parameter>  _parameters;
+    std::string             _strings;
+
+    // where the tables are read from
+    const Node*             _nodeData = nullptr;
+    const Parameter*        _parameterData = nullptr;
+    const char*             _stringData = nullptr;
+    std::size_t             _nodeCount = 0;
+    std::size_t             _parameterCount = 0;
+    std::size_t             _stringLength = 0;
+
+    BBFrozenDocument() = default;
+
+    void attachOwned();
+
+    // null with the reason in `error` if the buffer is not a serialized document
+    static BBFrozenDocumentPtr read(const void* data, std::size_t size, const char*& error);
+
+    // the first problem found in the tables, or null
+    const char* validate() const;
+
+    std::string_view view(std::uint32_t offset, std::uint32_t length) const
+    {
+        return std::string_view(_stringData + offset, length);
+    }
+};
+
+static_assert(sizeof(BBFrozenDocument::Node) == 36, "Node is written to buffers as is");
+static_assert(sizeof(BBFrozenDocument::Parameter) == 16, "Parameter is written to buffers as is");
+
+} // namespace
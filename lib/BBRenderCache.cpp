@@ -0,0 +1,184 @@
+#include <cstring>
+
+#include "BBRenderCache.h"
+
+namespace bbcpp
+{
+
+namespace
+{
+
+constexpr std::uint64_t Prime1 = 0x9e3779b97f4a7c15ull;
+constexpr std::uint64_t Prime2 = 0xc2b2ae3d27d4eb4full;
+constexpr std::uint64_t Prime3 = 0x165667b19e3779f9ull;
+
+inline std::uint64_t rotl(std::uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline std::uint64_t load64(const char* data)
+{
+    std::uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline std::uint64_t finalize(std::uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+std::size_t chargeFor(const std::string& output)
+{
+    return output.size() + BBRenderCache::EntryOverhead;
+}
+
+}
+
+BBRenderCache::BBRenderCache(std::size_t capacityBytes, std::size_t shardCount)
+{
+    unsigned int bits = 0;
+    while ((std::size_t(1) << bits) < shardCount && bits < 16)
+    {
+        bits++;
+    }
+
+    _shardShift = 64 - bits;
+    _shardCapacity = capacityBytes >> bits;
+
+    for (std::size_t i = 0; i < (std::size_t(1) << bits); i++)
+    {
+        _shards.emplace_back(new Shard());
+    }
+}
+
+std::uint64_t BBRenderCache::hash(std::string_view data, std::uint64_t seed)
+{
+    // eight bytes per step in one lane, then a murmur3 style finalizer
+    auto code = (seed + Prime3) ^ (data.size() * Prime1);
+    auto p = data.data();
+    auto remaining = data.size();
+
+    for (; remaining >= 8; p += 8, remaining -= 8)
+    {
+        code = rotl(code ^ (load64(p) * Prime2), 31) * Prime1;
+    }
+
+    if (remaining > 0)
+    {
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, p, remaining);
+        code = rotl(code ^ (tail * Prime3), 27) * Prime1;
+    }
+
+    return finalize(code);
+}
+
+BBRenderCache::Value BBRenderCache::get(std::uint64_t key)
+{
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const auto it = shard.index.find(key);
+    if (it == shard.index.end())
+    {
+        shard.stats.misses++;
+        return nullptr;
+    }
+
+    shard.stats.hits++;
+    shard.order.splice(shard.order.begin(), shard.order, it->second);
+    return it->second->value;
+}
+
+void BBRenderCache::put(std::uint64_t key, std::string_view output)
+{
+    insert(key, std::make_shared<const std::string>(output));
+}
+
+void BBRenderCache::insert(std::uint64_t key, Value value)
+{
+    const auto charge = chargeFor(*value);
+
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const auto existing = shard.index.find(key);
+    if (existing != shard.index.end())
+    {
+        shard.bytes -= chargeFor(*existing->second->value);
+        shard.order.erase(existing->second);
+        shard.index.erase(existing);
+    }
+
+    if (charge > _shardCapacity)
+    {
+        return;
+    }
+
+    while (shard.bytes + charge > _shardCapacity)
+    {
+        const auto& oldest = shard.order.back();
+        shard.bytes -= chargeFor(*oldest.value);
+        shard.index.erase(oldest.key);
+        shard.order.pop_back();
+        shard.stats.evictions++;
+    }
+
+    shard.order.push_front(Entry{ key, std::move(value) });
+    shard.index.emplace(key, shard.order.begin());
+    shard.bytes += charge;
+    shard.stats.insertions++;
+}
+
+bool BBRenderCache::erase(std::uint64_t key)
+{
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const auto it = shard.index.find(key);
+    if (it == shard.index.end())
+    {
+        return false;
+    }
+
+    shard.bytes -= chargeFor(*it->second->value);
+    shard.order.erase(it->second);
+    shard.index.erase(it);
+    return true;
+}
+
+void BBRenderCache::clear()
+{
+    for (auto& shard : _shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->order.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+    }
+}
+
+BBRenderCache::Stats BBRenderCache::getStats() const
+{
+    Stats total;
+    for (const auto& shard : _shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total.hits += shard->stats.hits;
+        total.misses += shard->stats.misses;
+        total.insertions += shard->stats.insertions;
+        total.evictions += shard->stats.evictions;
+        total.entries += shard->index.size();
+        total.bytes += shard->bytes;
+    }
+    return total;
+}
+
+} // namespace
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace bbcpp
+{
+
+// A bounded cache from a 64-bit key to rendered output, for inputs that are
+// rendered over and over (popular posts). The key is normally
+// hash(bbcode, options), where `options` tells renderers and their settings
+// apart; two inputs only share an entry if their 64-bit hashes collide.
+//
+// The capacity is in bytes: an entry costs its output plus EntryOverhead.
+// Keys are spread over shards, each with its own lock and least recently used
+// order, so threads rendering different posts rarely wait for each other.
+// Every method may be called from any thread.
+class BBRenderCache
+{
+public:
+    // bookkeeping charged to each entry on top of the output bytes
+    static constexpr std::size_t EntryOverhead = 64;
+
+    struct Stats
+    {
+        std::uint64_t   hits = 0;
+        std::uint64_t   misses = 0;
+        std::uint64_t   insertions = 0;
+        std::uint64_t   evictions = 0;      // entries dropped to make room
+        std::size_t     entries = 0;
+        std::size_t     bytes = 0;          // charged bytes currently held
+    };
+
+    using Value = std::shared_ptr<const std::string>;
+
+    // shardCount is rounded up to a power of two
+    explicit BBRenderCache(std::size_t capacityBytes, std::size_t shardCount = 16);
+
+    BBRenderCache(const BBRenderCache&) = delete;
+    BBRenderCache& operator=(const BBRenderCache&) = delete;
+
+    // A fast, non-cryptographic hash of `data` mixed with `seed`. Stable
+    // within a process, not across platforms of different byte order.
+    static std::uint64_t hash(std::string_view data, std::uint64_t seed = 0);
+
+    // the cached output for `key` or nullptr, a hit makes the entry most recent
+    Value get(std::uint64_t key);
+
+    // stores a copy of `output`, evicting least recently used entries of the
+    // shard as needed; output larger than a shard's capacity is not kept
+    void put(std::uint64_t key, std::string_view output);
+
+    // the output cached for `key`, rendering and storing it on a miss.
+    // `render` is called without any lock held.
+    template<typename RenderT>
+    Value getOrRender(std::uint64_t key, RenderT&& render)
+    {
+        if (auto value = get(key))
+        {
+            return value;
+        }
+
+        auto value = std::make_shared<const std::string>(render());
+        insert(key, value);
+        return value;
+    }
+
+    bool erase(std::uint64_t key);
+    void clear();
+
+    Stats getStats() const;
+    std::size_t getCapacity() const { return _shardCapacity * _shards.size(); }
+
+private:
+    struct Entry
+    {
+        std::uint64_t   key;
+        Value           value;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex  mutex;
+        std::list<Entry>    order;      // most recently used first
+        std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+        std::size_t         bytes = 0;
+        Stats               stats;
+    };
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::size_t                         _shardCapacity;
+    unsigned int                        _shardShift;
+
+    Shard& shardFor(std::uint64_t key) const
+    {
+        // the low bits pick the hash map bucket, so shards use the high ones
+        return *_shards[_shardShift == 64 ? 0 : key >> _shardShift];
+    }
+
+    void insert(std::uint64_t key, Value value);
+};
+
+} // namespace
@@ -1,12 +1,25 @@
 #include "bbcpp_c.h"
 #include "BBDocument.h"
 #include "bbcpputils.h"
+#include "BBRenderCache.h"
 #include <cstring>
 #include <memory>
 #include <stdexcept>
+#include <algorithm>
 
 using namespace bbcpp;
 
+/* Each entry point turns what the library throws, mostly std::bad_alloc, into an
+   error code. Built without exceptions nothing is thrown: the guarded block always
+   runs and the handler is left out. */
+#ifdef BBCPP_EXCEPTIONS
+#define BBCPP_TRY try
+#define BBCPP_CATCH catch (...)
+#else
+#define BBCPP_TRY if (true)
+#define BBCPP_CATCH else
+#endif
+
 /* Internal wrapper structures */
 struct bbcpp_document_t {
     BBDocumentPtr doc;
@@ -20,8 +33,21 @@ struct bbcpp_node_t {
     bbcpp_node_t(BBNodePtr n) : node(n) {}
 };
 
+struct bbcpp_tag_table_t {
+    BBTagTable table;
+};
+
+struct bbcpp_render_cache_t {
+    BBRenderCache cache;
+
+    bbcpp_render_cache_t(size_t capacity, size_t shards) : cache(capacity, shards) {}
+};
+
+static_assert(BBCPP_TAG_BR == static_cast<int>(BBTag::BR) && BBCPP_TAG_COUNT == static_cast<int>(BBTag::COUNT),
+    "bbcpp_tag must match BBTag");
+
 /* Helper functions */
-static bbcpp_error copy_string(const std::string& source, char* buffer, size_t buffer_size, size_t* length) {
+static bbcpp_error copy_string(std::string_view source, char* buffer, size_t buffer_size, size_t* length) {
     if (!buffer || !length) {
         return BBCPP_ERROR_NULL_POINTER;
     }
@@ -37,7 +63,8 @@ static bbcpp_error copy_string(const std::string& source, char* buffer, size_t b
         return BBCPP_ERROR_BUFFER_TOO_SMALL;
     }
 
-    std::memcpy(buffer, source.c_str(), source_len);
+    std::memcpy(buffer, source.data(), source_len);
+    buffer[source_len] = '\0';
     return BBCPP_SUCCESS;
 }
 
@@ -63,10 +90,10 @@ static bbcpp_element_type convert_element_type(BBElement::ElementType type) {
 
 /* Document functions */
 bbcpp_document_handle bbcpp_document_create(void) {
-    try {
+    BBCPP_TRY {
         auto doc = BBDocument::create();
         return new bbcpp_document_t(doc);
-    } catch (...) {
+    } BBCPP_CATCH {
         return nullptr;
     }
 }
@@ -77,19 +104,47 @@ void bbcpp_document_destroy(bbcpp_document_handle doc) {
     }
 }
 
+/* The 4 GB check of load() is made here, so the build without exceptions reports it too */
+static bbcpp_error load_document(bbcpp_document_handle doc, const char* bbcode, const ParseOptions& options) {
+    const size_t length = std::strlen(bbcode);
+    if (length > BBDocument::MaxSourceSize - doc->doc->getSource().size()) {
+        return BBCPP_ERROR_PARSE_ERROR;
+    }
+
+    BBCPP_TRY {
+        doc->doc->load(std::string(bbcode, length), options);
+        return BBCPP_SUCCESS;
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_PARSE_ERROR;
+    }
+}
+
 bbcpp_error bbcpp_document_load(bbcpp_document_handle doc, const char* bbcode) {
     if (!doc || !bbcode) {
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
-        doc->doc->load(std::string(bbcode));
-        return BBCPP_SUCCESS;
-    } catch (const std::exception&) {
-        return BBCPP_ERROR_PARSE_ERROR;
-    } catch (...) {
-        return BBCPP_ERROR_PARSE_ERROR;
+    static const ParseOptions defaults;
+    return load_document(doc, bbcode, defaults);
+}
+
+bbcpp_error bbcpp_document_load_with_limits(bbcpp_document_handle doc, const char* bbcode, const bbcpp_parse_limits* limits) {
+    if (!doc || !bbcode || !limits) {
+        return BBCPP_ERROR_NULL_POINTER;
     }
+
+    const auto cap = [](size_t value) {
+        return value == 0 ? ParseLimits::Unlimited : value;
+    };
+
+    ParseOptions options;
+    options.limits.maxDepth = cap(limits->max_depth);
+    options.limits.maxNodes = cap(limits->max_nodes);
+    options.limits.maxTextLength = cap(limits->max_text_length);
+    options.limits.maxParameters = cap(limits->max_parameters);
+    options.limits.maxTagNameLength = cap(limits->max_tag_name_length);
+
+    return load_document(doc, bbcode, options);
 }
 
 bbcpp_error bbcpp_document_get_children_count(bbcpp_document_handle doc, size_t* count) {
@@ -97,10 +152,10 @@ bbcpp_error bbcpp_document_get_children_count(bbcpp_document_handle doc, size_t*
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         *count = doc->doc->getChildren().size();
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
@@ -110,7 +165,7 @@ bbcpp_error bbcpp_document_get_child(bbcpp_document_handle doc, size_t index, bb
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         const auto& children = doc->doc->getChildren();
         if (index >= children.size()) {
             return BBCPP_ERROR_INVALID_ARGUMENT;
@@ -118,7 +173,7 @@ bbcpp_error bbcpp_document_get_child(bbcpp_document_handle doc, size_t index, bb
 
         *node = new bbcpp_node_t(children[index]);
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
@@ -128,24 +183,129 @@ bbcpp_error bbcpp_document_print(bbcpp_document_handle doc) {
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         printDocument(*doc->doc);
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+static bbcpp_error traverse_node(const BBNode& root, bbcpp_visit_callback callback, void* user_data) {
+    const auto visit = [callback, user_data](bbcpp_visit_event event) {
+        return [callback, user_data, event](const BBNode& node, std::size_t depth) {
+            // the document keeps the node alive for the whole walk, so the
+            // handle borrows it and skips the reference count
+            bbcpp_node_t handle(BBNodePtr(BBNodePtr(), const_cast<BBNode*>(&node)));
+            switch (callback(&handle, event, depth, user_data)) {
+                case BBCPP_VISIT_SKIP_CHILDREN: return VisitResult::SKIP_CHILDREN;
+                case BBCPP_VISIT_STOP: return VisitResult::STOP;
+                default: return VisitResult::CONTINUE;
+            }
+        };
+    };
+
+    BBCPP_TRY {
+        traverse(root, visit(BBCPP_VISIT_ENTER), visit(BBCPP_VISIT_LEAVE));
+        return BBCPP_SUCCESS;
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
 
+bbcpp_error bbcpp_document_traverse(bbcpp_document_handle doc, bbcpp_visit_callback callback, void* user_data) {
+    if (!doc || !callback) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    return traverse_node(*doc->doc, callback, user_data);
+}
+
+bbcpp_error bbcpp_document_get_stats(bbcpp_document_handle doc, bbcpp_document_stats* stats) {
+    if (!doc || !stats) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    const auto& docStats = doc->doc->getStats();
+    stats->element_count = docStats.elementCount;
+    stats->closing_count = docStats.closingCount;
+    stats->text_node_count = docStats.textNodeCount;
+    stats->text_length = docStats.textLength;
+    stats->max_depth = docStats.maxDepth;
+    stats->unique_tags = docStats.tagHistogram.size();
+    stats->degraded_tags = docStats.degradedTags;
+    stats->truncated = docStats.truncated ? 1 : 0;
+    return BBCPP_SUCCESS;
+}
+
+bbcpp_error bbcpp_document_get_tag_histogram_entry(bbcpp_document_handle doc, size_t index,
+                                                   char* name_buffer, size_t name_buffer_size, size_t* name_length,
+                                                   size_t* count) {
+    if (!doc || !count) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    BBCPP_TRY {
+        const auto& histogram = doc->doc->getStats().tagHistogram;
+        if (index >= histogram.size()) {
+            return BBCPP_ERROR_INVALID_ARGUMENT;
+        }
+
+        auto it = histogram.begin();
+        std::advance(it, index);
+
+        *count = it->second;
+        return copy_string(it->first, name_buffer, name_buffer_size, name_length);
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+bbcpp_error bbcpp_document_get_tag_histogram(bbcpp_document_handle doc, bbcpp_tag_histogram_entry* entries,
+                                             size_t max_entries, size_t* entry_count) {
+    if (!doc || !entry_count || (!entries && max_entries > 0)) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    const auto& histogram = doc->doc->getStats().tagHistogram;
+    size_t index = 0;
+    for (auto it = histogram.begin(); it != histogram.end() && index < max_entries; ++it, ++index) {
+        entries[index].name = it->first.c_str();
+        entries[index].name_length = it->first.size();
+        entries[index].count = it->second;
+    }
+
+    *entry_count = histogram.size();
+    return BBCPP_SUCCESS;
+}
+
+bbcpp_error bbcpp_document_get_source(bbcpp_document_handle doc, const char** source, size_t* length) {
+    if (!doc || !source || !length) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    const auto& bbcode = doc->doc->getSource();
+    *source = bbcode.data();
+    *length = bbcode.size();
+    return BBCPP_SUCCESS;
+}
+
 /* Node functions */
+void bbcpp_node_destroy(bbcpp_node_handle node) {
+    if (node) {
+        delete node;
+    }
+}
+
 bbcpp_error bbcpp_node_get_type(bbcpp_node_handle node, bbcpp_node_type* type) {
     if (!node || !type) {
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         *type = convert_node_type(node->node->getNodeType());
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
@@ -155,9 +315,9 @@ bbcpp_error bbcpp_node_get_name(bbcpp_node_handle node, char* buffer, size_t buf
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         return copy_string(node->node->getNodeName(), buffer, buffer_size, name_length);
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
@@ -167,10 +327,10 @@ bbcpp_error bbcpp_node_get_children_count(bbcpp_node_handle node, size_t* count)
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         *count = node->node->getChildren().size();
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
@@ -180,7 +340,7 @@ bbcpp_error bbcpp_node_get_child(bbcpp_node_handle node, size_t index, bbcpp_nod
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         const auto& children = node->node->getChildren();
         if (index >= children.size()) {
             return BBCPP_ERROR_INVALID_ARGUMENT;
@@ -188,7 +348,7 @@ bbcpp_error bbcpp_node_get_child(bbcpp_node_handle node, size_t index, bbcpp_nod
 
         *child = new bbcpp_node_t(children[index]);
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
@@ -198,7 +358,7 @@ bbcpp_error bbcpp_node_get_parent(bbcpp_node_handle node, bbcpp_node_handle* par
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         auto parent_ptr = node->node->getParent();
         if (!parent_ptr) {
             *parent = nullptr;
@@ -207,18 +367,45 @@ bbcpp_error bbcpp_node_get_parent(bbcpp_node_handle node, bbcpp_node_handle* par
 
         *parent = new bbcpp_node_t(parent_ptr);
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
 
+bbcpp_error bbcpp_node_get_source_spans(bbcpp_node_handle node, bbcpp_span* open_tag, bbcpp_span* content,
+                                        bbcpp_span* close_tag) {
+    if (!node) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    const auto convert = [](const BBSourceSpan& span, bbcpp_span* out) {
+        if (out) {
+            out->offset = span.begin;
+            out->length = span.size();
+        }
+    };
+
+    convert(node->node->getOpenTagSpan(), open_tag);
+    convert(node->node->getContentSpan(), content);
+    convert(node->node->getCloseTagSpan(), close_tag);
+    return BBCPP_SUCCESS;
+}
+
+bbcpp_error bbcpp_node_traverse(bbcpp_node_handle node, bbcpp_visit_callback callback, void* user_data) {
+    if (!node || !callback) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    return traverse_node(*node->node, callback, user_data);
+}
+
 /* Text node functions */
 bbcpp_error bbcpp_text_get_content(bbcpp_node_handle node, char* buffer, size_t buffer_size, size_t* content_length) {
     if (!node) {
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         if (node->node->getNodeType() != BBNode::NodeType::TEXT) {
             return BBCPP_ERROR_INVALID_ARGUMENT;
         }
@@ -229,9 +416,24 @@ bbcpp_error bbcpp_text_get_content(bbcpp_node_handle node, char* buffer, size_t
         }
 
         return copy_string(text_node->getText(), buffer, buffer_size, content_length);
-    } catch (...) {
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+bbcpp_error bbcpp_text_get_view(bbcpp_node_handle node, const char** text, size_t* length) {
+    if (!node || !text || !length) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    if (node->node->getNodeType() != BBNode::NodeType::TEXT) {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
+
+    const auto& content = node->node->getNodeName();
+    *text = content.data();
+    *length = content.size();
+    return BBCPP_SUCCESS;
 }
 
 /* Element node functions */
@@ -240,7 +442,7 @@ bbcpp_error bbcpp_element_get_type(bbcpp_node_handle node, bbcpp_element_type* t
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         if (node->node->getNodeType() != BBNode::NodeType::ELEMENT) {
             return BBCPP_ERROR_INVALID_ARGUMENT;
         }
@@ -252,9 +454,22 @@ bbcpp_error bbcpp_element_get_type(bbcpp_node_handle node, bbcpp_element_type* t
 
         *type = convert_element_type(element_node->getElementType());
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+bbcpp_error bbcpp_element_get_tag_id(bbcpp_node_handle node, int* tag_id) {
+    if (!node || !tag_id) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    if (node->node->getNodeType() != BBNode::NodeType::ELEMENT) {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
+
+    *tag_id = static_cast<int>(static_cast<const BBElement&>(*node->node).getTagId());
+    return BBCPP_SUCCESS;
 }
 
 bbcpp_error bbcpp_element_get_parameter_count(bbcpp_node_handle node, size_t* count) {
@@ -262,7 +477,7 @@ bbcpp_error bbcpp_element_get_parameter_count(bbcpp_node_handle node, size_t* co
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         if (node->node->getNodeType() != BBNode::NodeType::ELEMENT) {
             return BBCPP_ERROR_INVALID_ARGUMENT;
         }
@@ -274,7 +489,7 @@ bbcpp_error bbcpp_element_get_parameter_count(bbcpp_node_handle node, size_t* co
 
         *count = element_node->getParameters().size();
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
@@ -286,7 +501,7 @@ bbcpp_error bbcpp_element_get_parameter_by_index(bbcpp_node_handle node, size_t
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         if (node->node->getNodeType() != BBNode::NodeType::ELEMENT) {
             return BBCPP_ERROR_INVALID_ARGUMENT;
         }
@@ -309,7 +524,7 @@ bbcpp_error bbcpp_element_get_parameter_by_index(bbcpp_node_handle node, size_t
 
         if (key_result != BBCPP_SUCCESS) return key_result;
         return value_result;
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
@@ -320,7 +535,7 @@ bbcpp_error bbcpp_element_get_parameter(bbcpp_node_handle node, const char* key,
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         if (node->node->getNodeType() != BBNode::NodeType::ELEMENT) {
             return BBCPP_ERROR_INVALID_ARGUMENT;
         }
@@ -330,13 +545,12 @@ bbcpp_error bbcpp_element_get_parameter(bbcpp_node_handle node, const char* key,
             return BBCPP_ERROR_INVALID_ARGUMENT;
         }
 
-        try {
-            std::string value = element_node->getParameter(std::string(key), true);
-            return copy_string(value, value_buffer, value_buffer_size, value_length);
-        } catch (const std::invalid_argument&) {
+        std::string_view value;
+        if (!element_node->findParameter(std::string(key), value)) {
             return BBCPP_ERROR_NOT_FOUND;
         }
-    } catch (...) {
+        return copy_string(value, value_buffer, value_buffer_size, value_length);
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
@@ -346,7 +560,7 @@ bbcpp_error bbcpp_element_has_parameter(bbcpp_node_handle node, const char* key,
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         if (node->node->getNodeType() != BBNode::NodeType::ELEMENT) {
             return BBCPP_ERROR_INVALID_ARGUMENT;
         }
@@ -356,29 +570,340 @@ bbcpp_error bbcpp_element_has_parameter(bbcpp_node_handle node, const char* key,
             return BBCPP_ERROR_INVALID_ARGUMENT;
         }
 
-        try {
-            element_node->getParameter(std::string(key), true);
-            *has_parameter = 1;
-        } catch (const std::invalid_argument&) {
-            *has_parameter = 0;
-        }
+        std::string_view value;
+        *has_parameter = element_node->findParameter(std::string(key), value) ? 1 : 0;
 
         return BBCPP_SUCCESS;
-    } catch (...) {
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+bbcpp_error bbcpp_element_get_value(bbcpp_node_handle node, char* buffer, size_t buffer_size, size_t* value_length) {
+    if (!node) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    BBCPP_TRY {
+        if (node->node->getNodeType() != BBNode::NodeType::ELEMENT) {
+            return BBCPP_ERROR_INVALID_ARGUMENT;
+        }
+
+        const auto& element = static_cast<const BBElement&>(*node->node);
+        if (element.getElementType() != BBElement::VALUE) {
+            return BBCPP_ERROR_NOT_FOUND;
+        }
+
+        return copy_string(element.getValue(), buffer, buffer_size, value_length);
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
 
+bbcpp_error bbcpp_element_get_value_field(bbcpp_node_handle node, size_t index,
+                                          char* buffer, size_t buffer_size, size_t* field_length) {
+    if (!node) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    BBCPP_TRY {
+        if (node->node->getNodeType() != BBNode::NodeType::ELEMENT) {
+            return BBCPP_ERROR_INVALID_ARGUMENT;
+        }
+
+        const auto& element = static_cast<const BBElement&>(*node->node);
+        std::string_view field;
+        if (element.getElementType() != BBElement::VALUE || !element.findValueField(index, field)) {
+            return BBCPP_ERROR_NOT_FOUND;
+        }
+
+        return copy_string(field, buffer, buffer_size, field_length);
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+/* Looks up the element behind `node` for the typed value getters */
+static const BBElement* value_element(bbcpp_node_handle node) {
+    if (node->node->getNodeType() != BBNode::NodeType::ELEMENT) {
+        return nullptr;
+    }
+    return static_cast<const BBElement*>(node->node.get());
+}
+
+bbcpp_error bbcpp_element_get_color(bbcpp_node_handle node, uint32_t* rgba) {
+    if (!node || !rgba) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    const auto element = value_element(node);
+    if (!element) {
+        return BBCPP_ERROR_INVALID_ARGUMENT;
+    }
+
+    std::uint32_t color = 0;
+    if (!element->getColor(color)) {
+        return BBCPP_ERROR_NOT_FOUND;
+    }
+
+    *rgba = color;
+    return BBCPP_SUCCESS;
+}
+
+bbcpp_error bbcpp_element_get_integer(bbcpp_node_handle node, int64_t* value) {
+    if (!node || !value) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    const auto element = value_element(node);
+    if (!element) {
+        return BBCPP_ERROR_INVALID_ARGUMENT;
+    }
+
+    std::int64_t integer = 0;
+    if (!element->getInteger(integer)) {
+        return BBCPP_ERROR_NOT_FOUND;
+    }
+
+    *value = integer;
+    return BBCPP_SUCCESS;
+}
+
+bbcpp_error bbcpp_element_get_url(bbcpp_node_handle node, const char** url, size_t* length) {
+    if (!node || !url || !length) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    const auto element = value_element(node);
+    if (!element) {
+        return BBCPP_ERROR_INVALID_ARGUMENT;
+    }
+
+    std::string_view found;
+    if (!element->getUrl(found)) {
+        return BBCPP_ERROR_NOT_FOUND;
+    }
+
+    *url = found.data();
+    *length = found.size();
+    return BBCPP_SUCCESS;
+}
+
+/* Tokenizer functions */
+static bbcpp_span make_span(const char* base, std::string_view view) {
+    bbcpp_span span = { 0, 0 };
+    if (!view.empty()) {
+        span.offset = static_cast<size_t>(view.data() - base);
+        span.length = view.size();
+    }
+    return span;
+}
+
+void bbcpp_tokenizer_init(bbcpp_tokenizer* tokenizer, const char* input, size_t length) {
+    if (!tokenizer) {
+        return;
+    }
+
+    tokenizer->input = input;
+    tokenizer->length = input ? length : 0;
+    tokenizer->position = 0;
+}
+
+int bbcpp_tokenizer_next(bbcpp_tokenizer* tokenizer, bbcpp_token* token) {
+    if (!tokenizer || !token || !tokenizer->input) {
+        return 0;
+    }
+
+    BBTokenizer it(tokenizer->input, tokenizer->input + tokenizer->length);
+    it.setPosition(tokenizer->position);
+
+    BBToken next;
+    if (!it.next(next)) {
+        std::memset(token, 0, sizeof(bbcpp_token));
+        token->type = BBCPP_TOKEN_END;
+        return 0;
+    }
+
+    switch (next.type) {
+        case BBToken::Type::ELEMENT: token->type = BBCPP_TOKEN_ELEMENT; break;
+        case BBToken::Type::CLOSING: token->type = BBCPP_TOKEN_CLOSING; break;
+        default: token->type = BBCPP_TOKEN_TEXT; break;
+    }
+
+    token->source = make_span(tokenizer->input, next.source);
+    token->name = make_span(tokenizer->input, next.name);
+    token->key = make_span(tokenizer->input, next.key);
+    token->value = make_span(tokenizer->input, next.value);
+    token->tag_id = next.tagId == BBTag::NONE ? -1 : static_cast<int>(next.tagId);
+
+    tokenizer->position = it.position();
+    return 1;
+}
+
+int bbcpp_tokenizer_skip_raw(bbcpp_tokenizer* tokenizer, const bbcpp_token* token, bbcpp_span* content) {
+    if (!tokenizer || !token || !tokenizer->input) {
+        return 0;
+    }
+
+    BBToken opener;
+    opener.type = token->type == BBCPP_TOKEN_ELEMENT ? BBToken::Type::ELEMENT : BBToken::Type::TEXT;
+    opener.tagId = token->tag_id < 0 ? BBTag::NONE : static_cast<BBTagId>(token->tag_id);
+    opener.name = std::string_view(tokenizer->input + token->name.offset, token->name.length);
+
+    BBTokenizer it(tokenizer->input, tokenizer->input + tokenizer->length);
+    it.setPosition(tokenizer->position);
+
+    std::string_view raw;
+    if (!it.skipRaw(opener, raw)) {
+        return 0;
+    }
+
+    if (content) {
+        content->offset = tokenizer->position;
+        content->length = raw.size();
+    }
+    tokenizer->position = it.position();
+    return 1;
+}
+
+/* Tag table functions */
+bbcpp_tag_table_handle bbcpp_tag_table_create(void) {
+    BBCPP_TRY {
+        return new bbcpp_tag_table_t();
+    } BBCPP_CATCH {
+        return nullptr;
+    }
+}
+
+void bbcpp_tag_table_destroy(bbcpp_tag_table_handle table) {
+    if (table) {
+        delete table;
+    }
+}
+
+int bbcpp_tag_table_add(bbcpp_tag_table_handle table, const char* name) {
+    if (!table || !name) {
+        return -1;
+    }
+
+    BBCPP_TRY {
+        return static_cast<int>(table->table.intern(name));
+    } BBCPP_CATCH {
+        return -1;
+    }
+}
+
+int bbcpp_tag_table_find(bbcpp_tag_table_handle table, const char* name, size_t name_length) {
+    if (!table || !name) {
+        return -1;
+    }
+
+    const auto id = table->table.find(std::string_view(name, name_length));
+    return id == BBTagTable::npos ? -1 : static_cast<int>(id);
+}
+
+bbcpp_error bbcpp_tag_table_count(bbcpp_tag_table_handle table, const char* bbcode, size_t length, size_t* counts) {
+    if (!table || !bbcode || (!counts && table->table.size() > 0)) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    BBCPP_TRY {
+        std::vector<std::size_t> result;
+        countTags(std::string_view(bbcode, length), table->table, result);
+        std::copy(result.begin(), result.end(), counts);
+        return BBCPP_SUCCESS;
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+/* Render cache functions */
+bbcpp_render_cache_handle bbcpp_render_cache_create(size_t capacity_bytes, size_t shard_count) {
+    BBCPP_TRY {
+        return new bbcpp_render_cache_t(capacity_bytes, shard_count == 0 ? 16 : shard_count);
+    } BBCPP_CATCH {
+        return nullptr;
+    }
+}
+
+void bbcpp_render_cache_destroy(bbcpp_render_cache_handle cache) {
+    if (cache) {
+        delete cache;
+    }
+}
+
+uint64_t bbcpp_render_cache_key(const char* input, size_t length, uint64_t options) {
+    if (!input) {
+        length = 0;
+    }
+
+    return BBRenderCache::hash(std::string_view(input ? input : "", length), options);
+}
+
+bbcpp_error bbcpp_render_cache_get(bbcpp_render_cache_handle cache, uint64_t key,
+                                   char* buffer, size_t buffer_size, size_t* length) {
+    if (!cache || !buffer || !length) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    BBCPP_TRY {
+        const auto value = cache->cache.get(key);
+        if (!value) {
+            return BBCPP_ERROR_NOT_FOUND;
+        }
+        return copy_string(*value, buffer, buffer_size, length);
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+bbcpp_error bbcpp_render_cache_put(bbcpp_render_cache_handle cache, uint64_t key, const char* output, size_t length) {
+    if (!cache || (!output && length > 0)) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    BBCPP_TRY {
+        cache->cache.put(key, std::string_view(output ? output : "", length));
+        return BBCPP_SUCCESS;
+    } BBCPP_CATCH {
+        return BBCPP_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+bbcpp_error bbcpp_render_cache_clear(bbcpp_render_cache_handle cache) {
+    if (!cache) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    cache->cache.clear();
+    return BBCPP_SUCCESS;
+}
+
+bbcpp_error bbcpp_render_cache_get_stats(bbcpp_render_cache_handle cache, bbcpp_render_cache_stats* stats) {
+    if (!cache || !stats) {
+        return BBCPP_ERROR_NULL_POINTER;
+    }
+
+    const auto totals = cache->cache.getStats();
+    stats->hits = totals.hits;
+    stats->misses = totals.misses;
+    stats->insertions = totals.insertions;
+    stats->evictions = totals.evictions;
+    stats->entries = totals.entries;
+    stats->bytes = totals.bytes;
+    return BBCPP_SUCCESS;
+}
+
 /* Utility functions */
 bbcpp_error bbcpp_get_raw_string(bbcpp_node_handle node, char* buffer, size_t buffer_size, size_t* content_length) {
     if (!node) {
         return BBCPP_ERROR_NULL_POINTER;
     }
 
-    try {
+    BBCPP_TRY {
         std::string raw_string = getRawString(*node->node);
         return copy_string(raw_string, buffer, buffer_size, content_length);
-    } catch (...) {
+    } BBCPP_CATCH {
         return BBCPP_ERROR_INVALID_ARGUMENT;
     }
 }
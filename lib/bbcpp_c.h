@@ -6,10 +6,13 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 /* Opaque handles for C interface */
 typedef struct bbcpp_document_t* bbcpp_document_handle;
 typedef struct bbcpp_node_t* bbcpp_node_handle;
+typedef struct bbcpp_tag_table_t* bbcpp_tag_table_handle;
+typedef struct bbcpp_render_cache_t* bbcpp_render_cache_handle;
 
 /* Node types */
 typedef enum {
@@ -27,6 +30,27 @@ typedef enum {
     BBCPP_ELEMENT_CLOSING = 3
 } bbcpp_element_type;
 
+/* Canonical ids of the common tags, whatever case they are written in. A document
+   numbers any other tag name from BBCPP_TAG_COUNT up. */
+typedef enum {
+    BBCPP_TAG_B = 0,
+    BBCPP_TAG_I = 1,
+    BBCPP_TAG_U = 2,
+    BBCPP_TAG_S = 3,
+    BBCPP_TAG_CODE = 4,
+    BBCPP_TAG_QUOTE = 5,
+    BBCPP_TAG_URL = 6,
+    BBCPP_TAG_IMG = 7,
+    BBCPP_TAG_COLOR = 8,
+    BBCPP_TAG_SIZE = 9,
+    BBCPP_TAG_LIST = 10,
+    BBCPP_TAG_NOPARSE = 11,
+    BBCPP_TAG_STAR = 12,    /* [*] list item */
+    BBCPP_TAG_HR = 13,
+    BBCPP_TAG_BR = 14,
+    BBCPP_TAG_COUNT = 15
+} bbcpp_tag;
+
 /* Error codes */
 typedef enum {
     BBCPP_SUCCESS = 0,
@@ -38,26 +62,149 @@ typedef enum {
     BBCPP_ERROR_NOT_FOUND = -6
 } bbcpp_error;
 
+/* A byte range inside an input string */
+typedef struct {
+    size_t offset;
+    size_t length;
+} bbcpp_span;
+
+/* Token types produced by the streaming tokenizer */
+typedef enum {
+    BBCPP_TOKEN_END = 0,
+    BBCPP_TOKEN_TEXT = 1,
+    BBCPP_TOKEN_ELEMENT = 2,
+    BBCPP_TOKEN_CLOSING = 3
+} bbcpp_token_type;
+
+/* A single token, all spans point into the tokenized input */
+typedef struct {
+    bbcpp_token_type type;
+    bbcpp_span source;  /* the whole token */
+    bbcpp_span name;    /* element name */
+    bbcpp_span key;     /* parameter key, empty for [tag=value] and elements without one */
+    bbcpp_span value;   /* parameter value, or the value of [tag=value] */
+    int tag_id;         /* bbcpp_tag of the element name, -1 for other names */
+} bbcpp_token;
+
+/* Tokenizer state, walks the input without allocating or building a tree */
+typedef struct {
+    const char* input;
+    size_t length;
+    size_t position;
+} bbcpp_tokenizer;
+
+/* Statistics collected while a document is parsed */
+typedef struct {
+    size_t element_count;   /* opening tags */
+    size_t closing_count;   /* closing tags */
+    size_t text_node_count;
+    size_t text_length;
+    size_t max_depth;
+    size_t unique_tags;
+    size_t degraded_tags;   /* tags kept as text because of bbcpp_parse_limits */
+    int truncated;          /* non-zero when a limit ended the load early */
+} bbcpp_document_stats;
+
+/* A tag of the histogram; the name is null-terminated and points into the document */
+typedef struct {
+    const char* name;
+    size_t name_length;
+    size_t count;
+} bbcpp_tag_histogram_entry;
+
+/* Caps for bbcpp_document_load_with_limits, 0 means unlimited.
+   Tags over the depth, parameter or name-length caps are kept as text;
+   reaching the node or text cap ends the load early. */
+typedef struct {
+    size_t max_depth;
+    size_t max_nodes;
+    size_t max_text_length;
+    size_t max_parameters;
+    size_t max_tag_name_length;
+} bbcpp_parse_limits;
+
+/* Tree traversal: the callback is called when entering a node (before its
+   children) and when leaving it (after them), in document order. The node
+   handle is only valid during the call and must not be destroyed. */
+typedef enum {
+    BBCPP_VISIT_ENTER = 0,
+    BBCPP_VISIT_LEAVE = 1
+} bbcpp_visit_event;
+
+typedef enum {
+    BBCPP_VISIT_CONTINUE = 0,
+    BBCPP_VISIT_SKIP_CHILDREN = 1,  /* from ENTER: skip this node's children, LEAVE still follows */
+    BBCPP_VISIT_STOP = 2
+} bbcpp_visit_result;
+
+/* Render cache counters, summed over all shards */
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;     /* entries dropped to make room */
+    size_t entries;
+    size_t bytes;           /* output bytes held plus a fixed overhead per entry */
+} bbcpp_render_cache_stats;
+
+/* Renderer ids mixed into cache keys by the bbcpp_simple_*_cached functions,
+   other renderers should pick their own value for options */
+#define BBCPP_RENDER_TEXT 1
+#define BBCPP_RENDER_HTML 2
+
+typedef bbcpp_visit_result (*bbcpp_visit_callback)(bbcpp_node_handle node, bbcpp_visit_event event,
+                                                   size_t depth, void* user_data);
+
 /* Document functions */
 bbcpp_document_handle bbcpp_document_create(void);
 void bbcpp_document_destroy(bbcpp_document_handle doc);
 bbcpp_error bbcpp_document_load(bbcpp_document_handle doc, const char* bbcode);
+bbcpp_error bbcpp_document_load_with_limits(bbcpp_document_handle doc, const char* bbcode, const bbcpp_parse_limits* limits);
 bbcpp_error bbcpp_document_get_children_count(bbcpp_document_handle doc, size_t* count);
 bbcpp_error bbcpp_document_get_child(bbcpp_document_handle doc, size_t index, bbcpp_node_handle* node);
 bbcpp_error bbcpp_document_print(bbcpp_document_handle doc);
+/* Walks every node of the document without recursion, top-level nodes have depth 0 */
+bbcpp_error bbcpp_document_traverse(bbcpp_document_handle doc, bbcpp_visit_callback callback, void* user_data);
+bbcpp_error bbcpp_document_get_stats(bbcpp_document_handle doc, bbcpp_document_stats* stats);
+/* Tag names in the histogram are in lower case, [B] and [b] count as one tag.
+   Finding an entry takes `index` steps, so read the whole histogram with the function below. */
+bbcpp_error bbcpp_document_get_tag_histogram_entry(bbcpp_document_handle doc, size_t index,
+                                                   char* name_buffer, size_t name_buffer_size, size_t* name_length,
+                                                   size_t* count);
+/* Fills at most max_entries entries in name order in one pass and sets entry_count to the number
+   of tags. The names are valid until the document is loaded again or destroyed. */
+bbcpp_error bbcpp_document_get_tag_histogram(bbcpp_document_handle doc, bbcpp_tag_histogram_entry* entries,
+                                             size_t max_entries, size_t* entry_count);
+/* Points at everything loaded into the document without copying it, valid until the document
+   is loaded again or destroyed. The source is not null-terminated. */
+bbcpp_error bbcpp_document_get_source(bbcpp_document_handle doc, const char** source, size_t* length);
 
 /* Node functions */
+/* Handles returned by the get_child/get_parent functions must be released with this */
+void bbcpp_node_destroy(bbcpp_node_handle node);
 bbcpp_error bbcpp_node_get_type(bbcpp_node_handle node, bbcpp_node_type* type);
 bbcpp_error bbcpp_node_get_name(bbcpp_node_handle node, char* buffer, size_t buffer_size, size_t* name_length);
 bbcpp_error bbcpp_node_get_children_count(bbcpp_node_handle node, size_t* count);
 bbcpp_error bbcpp_node_get_child(bbcpp_node_handle node, size_t index, bbcpp_node_handle* child);
 bbcpp_error bbcpp_node_get_parent(bbcpp_node_handle node, bbcpp_node_handle* parent);
+/* Where the node's opening tag, content and closing tag are in bbcpp_document_get_source().
+   Text is all content, and the closing tag of an unclosed element is empty. Any of the
+   spans may be NULL. */
+bbcpp_error bbcpp_node_get_source_spans(bbcpp_node_handle node, bbcpp_span* open_tag, bbcpp_span* content,
+                                        bbcpp_span* close_tag);
+/* Walks every node below node without recursion, its children have depth 0 */
+bbcpp_error bbcpp_node_traverse(bbcpp_node_handle node, bbcpp_visit_callback callback, void* user_data);
 
 /* Text node functions */
 bbcpp_error bbcpp_text_get_content(bbcpp_node_handle node, char* buffer, size_t buffer_size, size_t* content_length);
+/* Points at the text without copying it, valid until the document is loaded again or destroyed.
+   The text is not null-terminated. */
+bbcpp_error bbcpp_text_get_view(bbcpp_node_handle node, const char** text, size_t* length);
 
 /* Element node functions */
 bbcpp_error bbcpp_element_get_type(bbcpp_node_handle node, bbcpp_element_type* type);
+/* A bbcpp_tag for the common tags, or the id the document gave any other name */
+bbcpp_error bbcpp_element_get_tag_id(bbcpp_node_handle node, int* tag_id);
 bbcpp_error bbcpp_element_get_parameter_count(bbcpp_node_handle node, size_t* count);
 bbcpp_error bbcpp_element_get_parameter_by_index(bbcpp_node_handle node, size_t index, 
                                                  char* key_buffer, size_t key_buffer_size, size_t* key_length,
@@ -65,6 +212,51 @@ bbcpp_error bbcpp_element_get_parameter_by_index(bbcpp_node_handle node, size_t
 bbcpp_error bbcpp_element_get_parameter(bbcpp_node_handle node, const char* key,
                                         char* value_buffer, size_t value_buffer_size, size_t* value_length);
 bbcpp_error bbcpp_element_has_parameter(bbcpp_node_handle node, const char* key, int* has_parameter);
+/* The value of a BBCPP_ELEMENT_VALUE element, "Bob;1234" for [quote=Bob;1234], and its
+   ';' separated fields: field 0 is "Bob", field 1 is "1234". BBCPP_ERROR_NOT_FOUND
+   for other elements and past the last field. */
+bbcpp_error bbcpp_element_get_value(bbcpp_node_handle node, char* buffer, size_t buffer_size, size_t* value_length);
+bbcpp_error bbcpp_element_get_value_field(bbcpp_node_handle node, size_t index,
+                                          char* buffer, size_t buffer_size, size_t* field_length);
+/* The value read as a color (0xRRGGBBAA), as an integer from its last ';' field, or
+   as a URL that is safe to link to. Each is decoded once and kept in the element; the
+   URL points into the element and lives as long as the document. BBCPP_ERROR_NOT_FOUND
+   when the value is not one. */
+bbcpp_error bbcpp_element_get_color(bbcpp_node_handle node, uint32_t* rgba);
+bbcpp_error bbcpp_element_get_integer(bbcpp_node_handle node, int64_t* value);
+bbcpp_error bbcpp_element_get_url(bbcpp_node_handle node, const char** url, size_t* length);
+
+/* Tokenizer functions */
+void bbcpp_tokenizer_init(bbcpp_tokenizer* tokenizer, const char* input, size_t length);
+/* Returns 1 and fills token while there is input left, 0 at the end */
+int bbcpp_tokenizer_next(bbcpp_tokenizer* tokenizer, bbcpp_token* token);
+/* Call after a token: when it opens [code] or [noparse], moves past the content up to the
+   closing tag, which bbcpp_document_load() keeps as text, and returns 1 with the content
+   in content (which may be NULL). Returns 0 for any other token. */
+int bbcpp_tokenizer_skip_raw(bbcpp_tokenizer* tokenizer, const bbcpp_token* token, bbcpp_span* content);
+
+/* Tag table functions: case-insensitive tag name to id lookup in O(1) */
+bbcpp_tag_table_handle bbcpp_tag_table_create(void);
+void bbcpp_tag_table_destroy(bbcpp_tag_table_handle table);
+/* Returns the id of the name (adding it if needed), or -1 on error */
+int bbcpp_tag_table_add(bbcpp_tag_table_handle table, const char* name);
+/* Returns the id of the name, or -1 if it is not in the table */
+int bbcpp_tag_table_find(bbcpp_tag_table_handle table, const char* name, size_t name_length);
+/* Counts opening tags in one pass, counts is indexed by tag id and must hold one entry per name in the table */
+bbcpp_error bbcpp_tag_table_count(bbcpp_tag_table_handle table, const char* bbcode, size_t length, size_t* counts);
+
+/* Render cache functions: a bounded LRU cache of rendered output that is
+   safe to share between threads. Keys are 64-bit hashes of the input and the
+   renderer options. shard_count 0 picks the default. */
+bbcpp_render_cache_handle bbcpp_render_cache_create(size_t capacity_bytes, size_t shard_count);
+void bbcpp_render_cache_destroy(bbcpp_render_cache_handle cache);
+uint64_t bbcpp_render_cache_key(const char* input, size_t length, uint64_t options);
+/* Copies the output cached for key, BBCPP_ERROR_NOT_FOUND on a miss */
+bbcpp_error bbcpp_render_cache_get(bbcpp_render_cache_handle cache, uint64_t key,
+                                   char* buffer, size_t buffer_size, size_t* length);
+bbcpp_error bbcpp_render_cache_put(bbcpp_render_cache_handle cache, uint64_t key, const char* output, size_t length);
+bbcpp_error bbcpp_render_cache_clear(bbcpp_render_cache_handle cache);
+bbcpp_error bbcpp_render_cache_get_stats(bbcpp_render_cache_handle cache, bbcpp_render_cache_stats* stats);
 
 /* Utility functions */
 bbcpp_error bbcpp_get_raw_string(bbcpp_node_handle node, char* buffer, size_t buffer_size, size_t* content_length);
@@ -5,147 +5,225 @@
 
 static int debug_enabled = 0;
 
-/* Helper function to walk nodes and extract text */
-static void extract_text_recursive(bbcpp_node_handle node, char* buffer, size_t* pos, size_t max_size) {
-    if (!node || *pos >= max_size - 1) return;
-    
-    bbcpp_node_type type;
-    if (bbcpp_node_get_type(node, &type) != BBCPP_SUCCESS) return;
-    
-    if (type == BBCPP_NODE_TEXT) {
-        char content[512];
-        size_t content_length;
-        if (bbcpp_text_get_content(node, content, sizeof(content), &content_length) == BBCPP_SUCCESS) {
-            size_t copy_len = (content_length < max_size - *pos - 1) ? content_length : max_size - *pos - 1;
-            memcpy(buffer + *pos, content, copy_len);
-            *pos += copy_len;
-        }
+/* A replacement entry, indexed by the id of its tag in the tag table */
+typedef struct {
+    char* open;
+    size_t open_length;
+    char* close;
+    size_t close_length;
+} compiled_replacement;
+
+struct bbcpp_replacement_table_t {
+    bbcpp_tag_table_handle tags;
+    compiled_replacement* entries;
+    int count;
+};
+
+/* Helper function to compare a span of the input with a tag name, ignoring case */
+static char fold_case(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static int span_equals_name(const char* input, const bbcpp_span* span, const char* name) {
+    size_t i;
+    for (i = 0; i < span->length; i++) {
+        if (name[i] == '\0' || fold_case(input[span->offset + i]) != fold_case(name[i])) return 0;
     }
+    return name[i] == '\0';
+}
+
+/* Helper function to append to an output buffer, truncating at max_size - 1 */
+static void append_output(char* buffer, size_t* pos, size_t max_size, const char* text, size_t length) {
+    if (*pos >= max_size - 1) return;
     
-    /* Recursively process children */
-    size_t child_count;
-    if (bbcpp_node_get_children_count(node, &child_count) == BBCPP_SUCCESS) {
-        for (size_t i = 0; i < child_count; i++) {
-            bbcpp_node_handle child;
-            if (bbcpp_node_get_child(node, i, &child) == BBCPP_SUCCESS) {
-                extract_text_recursive(child, buffer, pos, max_size);
-            }
-        }
+    size_t copy_len = (length < max_size - *pos - 1) ? length : max_size - *pos - 1;
+    memcpy(buffer + *pos, text, copy_len);
+    *pos += copy_len;
+}
+
+/* Helper function to copy a replacement string */
+static char* copy_text(const char* text, size_t* length) {
+    *length = text ? strlen(text) : 0;
+    
+    char* copy = (char*)malloc(*length + 1);
+    if (copy) {
+        if (*length > 0) memcpy(copy, text, *length);
+        copy[*length] = '\0';
     }
+    return copy;
 }
 
-/* Helper function to count tags recursively */
-static int count_tags_recursive(bbcpp_node_handle node, const char* tag_name) {
-    if (!node) return 0;
-    
-    int count = 0;
-    bbcpp_node_type type;
-    if (bbcpp_node_get_type(node, &type) != BBCPP_SUCCESS) return 0;
-    
-    if (type == BBCPP_NODE_ELEMENT) {
-        char name[64];
-        size_t name_length;
-        if (bbcpp_node_get_name(node, name, sizeof(name), &name_length) == BBCPP_SUCCESS) {
-            if (strcmp(name, tag_name) == 0) {
-                count++;
+/* Helper function to find links with a single pass over the tokenizer, each link
+   is either written to spans or copied into urls (whichever is not NULL) */
+static int scan_urls(const char* bbcode, bbcpp_span* spans, char urls[][256], int max_urls) {
+    bbcpp_tokenizer tokenizer;
+    bbcpp_token token;
+    int open_tag = -1;
+    size_t content_start = 0;
+    int found = 0;
+    
+    bbcpp_tokenizer_init(&tokenizer, bbcode, strlen(bbcode));
+    
+    while (bbcpp_tokenizer_next(&tokenizer, &token)) {
+        bbcpp_span url = { 0, 0 };
+        
+        if (token.type == BBCPP_TOKEN_ELEMENT) {
+            if (token.tag_id == BBCPP_TAG_URL && token.key.length == 0 && token.value.length > 0) {
+                /* [url=http://example.com]text[/url]; [url title=x] links to its content */
+                url = token.value;
+                open_tag = -1;
+            } else if (token.tag_id == BBCPP_TAG_URL || token.tag_id == BBCPP_TAG_IMG) {
+                open_tag = token.tag_id;
+                content_start = token.source.offset + token.source.length;
             }
+            /* links inside [code] are text */
+            bbcpp_tokenizer_skip_raw(&tokenizer, &token, NULL);
+        } else if (token.type == BBCPP_TOKEN_CLOSING && open_tag >= 0 && token.tag_id == open_tag) {
+            /* [url]http://example.com[/url], [img]http://example.com/a.png[/img] */
+            url.offset = content_start;
+            url.length = token.source.offset - content_start;
+            open_tag = -1;
         }
-    }
-    
-    /* Recursively process children */
-    size_t child_count;
-    if (bbcpp_node_get_children_count(node, &child_count) == BBCPP_SUCCESS) {
-        for (size_t i = 0; i < child_count; i++) {
-            bbcpp_node_handle child;
-            if (bbcpp_node_get_child(node, i, &child) == BBCPP_SUCCESS) {
-                count += count_tags_recursive(child, tag_name);
+        
+        if (url.length == 0) continue;
+        
+        if (found < max_urls) {
+            if (spans) {
+                spans[found] = url;
+            } else if (urls) {
+                size_t copy_len = url.length < 255 ? url.length : 255;
+                memcpy(urls[found], bbcode + url.offset, copy_len);
+                urls[found][copy_len] = '\0';
             }
         }
+        found++;
     }
     
-    return count;
+    return found;
+}
+
+/* Output buffer shared by the tree visitors */
+typedef struct {
+    char* buffer;
+    size_t pos;
+    size_t max_size;
+    int truncated;      /* set when something did not fit */
+} output_buffer;
+
+/* Helper function to append text to an output buffer, truncating it if needed */
+static void append_text(output_buffer* out, const char* text, size_t length) {
+    if (out->pos + length >= out->max_size) out->truncated = 1;
+    append_output(out->buffer, &out->pos, out->max_size, text, length);
 }
 
-/* Helper function to convert node to HTML recursively */
-static void to_html_recursive(bbcpp_node_handle node, char* buffer, size_t* pos, size_t max_size) {
-    if (!node || *pos >= max_size - 1) return;
+/* Helper function to append a whole HTML tag, or nothing if it does not fit */
+static void append_tag(output_buffer* out, const char* tag) {
+    size_t length = strlen(tag);
+    if (out->pos + length < out->max_size - 1) {
+        memcpy(out->buffer + out->pos, tag, length);
+        out->pos += length;
+    } else if (length > 0) {
+        out->truncated = 1;
+    }
+}
+
+/* Helper function for the visitors, stops the walk once the buffer is full */
+static int output_full(output_buffer* out) {
+    if (out->pos < out->max_size - 1) return 0;
+    out->truncated = 1;
+    return 1;
+}
+
+/* Visitor that collects the text of every text node */
+static bbcpp_visit_result extract_text_visitor(bbcpp_node_handle node, bbcpp_visit_event event, size_t depth, void* user_data) {
+    output_buffer* out = (output_buffer*)user_data;
+    const char* text;
+    size_t length;
+    (void)depth;
+    
+    if (output_full(out)) return BBCPP_VISIT_STOP;
+    
+    if (event == BBCPP_VISIT_ENTER && bbcpp_text_get_view(node, &text, &length) == BBCPP_SUCCESS) {
+        append_text(out, text, length);
+    }
     
+    return BBCPP_VISIT_CONTINUE;
+}
+
+/* Helper function to map a BBCode element to its HTML tags */
+static void html_tags_for(int tag_id, const char** html_open, const char** html_close) {
+    *html_open = "";
+    *html_close = "";
+    
+    switch (tag_id) {
+        case BBCPP_TAG_B:
+            *html_open = "<strong>";
+            *html_close = "</strong>";
+            break;
+        case BBCPP_TAG_I:
+            *html_open = "<em>";
+            *html_close = "</em>";
+            break;
+        case BBCPP_TAG_U:
+            *html_open = "<u>";
+            *html_close = "</u>";
+            break;
+        case BBCPP_TAG_CODE:
+            *html_open = "<code>";
+            *html_close = "</code>";
+            break;
+        case BBCPP_TAG_QUOTE:
+            *html_open = "<blockquote>";
+            *html_close = "</blockquote>";
+            break;
+        case BBCPP_TAG_URL:
+            *html_open = "<a href=\"#\">";
+            *html_close = "</a>";
+            break;
+        default:
+            break;
+    }
+}
+
+/* Visitor that writes HTML: elements open on enter and close on leave, closing tags produce nothing */
+static bbcpp_visit_result to_html_visitor(bbcpp_node_handle node, bbcpp_visit_event event, size_t depth, void* user_data) {
+    output_buffer* out = (output_buffer*)user_data;
     bbcpp_node_type type;
-    if (bbcpp_node_get_type(node, &type) != BBCPP_SUCCESS) return;
+    (void)depth;
+    
+    if (output_full(out)) return BBCPP_VISIT_STOP;
+    if (bbcpp_node_get_type(node, &type) != BBCPP_SUCCESS) return BBCPP_VISIT_CONTINUE;
     
     if (type == BBCPP_NODE_TEXT) {
-        char content[512];
-        size_t content_length;
-        if (bbcpp_text_get_content(node, content, sizeof(content), &content_length) == BBCPP_SUCCESS) {
-            size_t copy_len = (content_length < max_size - *pos - 1) ? content_length : max_size - *pos - 1;
-            memcpy(buffer + *pos, content, copy_len);
-            *pos += copy_len;
+        const char* text;
+        size_t length;
+        if (event == BBCPP_VISIT_ENTER && bbcpp_text_get_view(node, &text, &length) == BBCPP_SUCCESS) {
+            append_text(out, text, length);
         }
     } else if (type == BBCPP_NODE_ELEMENT) {
-        char name[64];
-        size_t name_length;
-        if (bbcpp_node_get_name(node, name, sizeof(name), &name_length) == BBCPP_SUCCESS) {
-            /* Handle common BBCode to HTML conversions */
-            const char* html_open = "";
-            const char* html_close = "";
-            
-            if (strcmp(name, "b") == 0) {
-                html_open = "<strong>";
-                html_close = "</strong>";
-            } else if (strcmp(name, "i") == 0) {
-                html_open = "<em>";
-                html_close = "</em>";
-            } else if (strcmp(name, "u") == 0) {
-                html_open = "<u>";
-                html_close = "</u>";
-            } else if (strcmp(name, "code") == 0) {
-                html_open = "<code>";
-                html_close = "</code>";
-            } else if (strcmp(name, "quote") == 0) {
-                html_open = "<blockquote>";
-                html_close = "</blockquote>";
-            } else if (strcmp(name, "url") == 0) {
-                html_open = "<a href=\"#\">";
-                html_close = "</a>";
-            }
-            
-            /* Add opening tag */
-            size_t open_len = strlen(html_open);
-            if (*pos + open_len < max_size - 1) {
-                memcpy(buffer + *pos, html_open, open_len);
-                *pos += open_len;
-            }
-            
-            /* Process children */
-            size_t child_count;
-            if (bbcpp_node_get_children_count(node, &child_count) == BBCPP_SUCCESS) {
-                for (size_t i = 0; i < child_count; i++) {
-                    bbcpp_node_handle child;
-                    if (bbcpp_node_get_child(node, i, &child) == BBCPP_SUCCESS) {
-                        bbcpp_node_type child_type;
-                        if (bbcpp_node_get_type(child, &child_type) == BBCPP_SUCCESS && 
-                            child_type != BBCPP_NODE_ELEMENT) {
-                            to_html_recursive(child, buffer, pos, max_size);
-                        }
-                    }
-                }
-            }
-            
-            /* Add closing tag */
-            size_t close_len = strlen(html_close);
-            if (*pos + close_len < max_size - 1) {
-                memcpy(buffer + *pos, html_close, close_len);
-                *pos += close_len;
-            }
+        bbcpp_element_type element_type;
+        int tag_id;
+        const char* html_open;
+        const char* html_close;
+        
+        if (bbcpp_element_get_type(node, &element_type) != BBCPP_SUCCESS || element_type == BBCPP_ELEMENT_CLOSING) {
+            return BBCPP_VISIT_CONTINUE;
+        }
+        if (bbcpp_element_get_tag_id(node, &tag_id) != BBCPP_SUCCESS) {
+            return BBCPP_VISIT_CONTINUE;
         }
+        
+        html_tags_for(tag_id, &html_open, &html_close);
+        append_tag(out, event == BBCPP_VISIT_ENTER ? html_open : html_close);
     }
+    
+    return BBCPP_VISIT_CONTINUE;
 }
 
 /* Implementation of public functions */
 
-int bbcpp_simple_get_text(const char* bbcode, char* output, size_t output_size) {
-    if (!bbcode || !output || output_size == 0) return -1;
-    
+/* Helper function to load a document and write it out through a visitor */
+static int render_document(const char* bbcode, bbcpp_visit_callback visitor, output_buffer* out) {
     bbcpp_document_handle doc = bbcpp_document_create();
     if (!doc) return -1;
     
@@ -154,63 +232,49 @@ int bbcpp_simple_get_text(const char* bbcode, char* output, size_t output_size)
         return -1;
     }
     
-    output[0] = '\0';
-    size_t pos = 0;
-    
-    size_t child_count;
-    if (bbcpp_document_get_children_count(doc, &child_count) == BBCPP_SUCCESS) {
-        for (size_t i = 0; i < child_count; i++) {
-            bbcpp_node_handle child;
-            if (bbcpp_document_get_child(doc, i, &child) == BBCPP_SUCCESS) {
-                extract_text_recursive(child, output, &pos, output_size);
-            }
-        }
-    }
-    
-    if (pos < output_size) {
-        output[pos] = '\0';
-    } else {
-        output[output_size - 1] = '\0';
-    }
+    out->buffer[0] = '\0';
+    bbcpp_document_traverse(doc, visitor, out);
+    out->buffer[out->pos < out->max_size ? out->pos : out->max_size - 1] = '\0';
     
     bbcpp_document_destroy(doc);
     return 0;
 }
 
-int bbcpp_simple_to_html(const char* bbcode, char* output, size_t output_size) {
+/* Helper function to render through the cache when there is one. Truncated
+   output is never stored, a hit that does not fit is rendered again. */
+static int render_cached(bbcpp_render_cache_handle cache, uint64_t renderer, const char* bbcode,
+                         bbcpp_visit_callback visitor, char* output, size_t output_size) {
     if (!bbcode || !output || output_size == 0) return -1;
     
-    bbcpp_document_handle doc = bbcpp_document_create();
-    if (!doc) return -1;
-    
-    if (bbcpp_document_load(doc, bbcode) != BBCPP_SUCCESS) {
-        bbcpp_document_destroy(doc);
-        return -1;
-    }
-    
-    output[0] = '\0';
-    size_t pos = 0;
+    output_buffer out = { output, 0, output_size, 0 };
+    if (!cache) return render_document(bbcode, visitor, &out);
     
-    size_t child_count;
-    if (bbcpp_document_get_children_count(doc, &child_count) == BBCPP_SUCCESS) {
-        for (size_t i = 0; i < child_count; i++) {
-            bbcpp_node_handle child;
-            if (bbcpp_document_get_child(doc, i, &child) == BBCPP_SUCCESS) {
-                to_html_recursive(child, output, &pos, output_size);
-            }
-        }
-    }
+    uint64_t key = bbcpp_render_cache_key(bbcode, strlen(bbcode), renderer);
+    size_t length;
+    if (bbcpp_render_cache_get(cache, key, output, output_size, &length) == BBCPP_SUCCESS) return 0;
     
-    if (pos < output_size) {
-        output[pos] = '\0';
-    } else {
-        output[output_size - 1] = '\0';
-    }
+    if (render_document(bbcode, visitor, &out) != 0) return -1;
+    if (!out.truncated) bbcpp_render_cache_put(cache, key, output, out.pos);
     
-    bbcpp_document_destroy(doc);
     return 0;
 }
 
+int bbcpp_simple_get_text(const char* bbcode, char* output, size_t output_size) {
+    return render_cached(NULL, BBCPP_RENDER_TEXT, bbcode, extract_text_visitor, output, output_size);
+}
+
+int bbcpp_simple_to_html(const char* bbcode, char* output, size_t output_size) {
+    return render_cached(NULL, BBCPP_RENDER_HTML, bbcode, to_html_visitor, output, output_size);
+}
+
+int bbcpp_simple_get_text_cached(bbcpp_render_cache_handle cache, const char* bbcode, char* output, size_t output_size) {
+    return render_cached(cache, BBCPP_RENDER_TEXT, bbcode, extract_text_visitor, output, output_size);
+}
+
+int bbcpp_simple_to_html_cached(bbcpp_render_cache_handle cache, const char* bbcode, char* output, size_t output_size) {
+    return render_cached(cache, BBCPP_RENDER_HTML, bbcode, to_html_visitor, output, output_size);
+}
+
 int bbcpp_simple_has_tag(const char* bbcode, const char* tag_name) {
     if (!bbcode || !tag_name) return 0;
     
@@ -220,35 +284,52 @@ int bbcpp_simple_has_tag(const char* bbcode, const char* tag_name) {
 int bbcpp_simple_count_tags(const char* bbcode, const char* tag_name) {
     if (!bbcode || !tag_name) return 0;
     
-    bbcpp_document_handle doc = bbcpp_document_create();
-    if (!doc) return 0;
+    int count = 0;
+    if (bbcpp_simple_count_tags_multi(bbcode, &tag_name, 1, &count) != 0) return 0;
     
-    if (bbcpp_document_load(doc, bbcode) != BBCPP_SUCCESS) {
-        bbcpp_document_destroy(doc);
-        return 0;
+    return count;
+}
+
+int bbcpp_simple_count_tags_multi(const char* bbcode, const char** names, int num_names, int* counts) {
+    if (!bbcode || num_names < 0 || (num_names > 0 && (!names || !counts))) return -1;
+    if (num_names == 0) return 0;
+    
+    bbcpp_tag_table_handle table = bbcpp_tag_table_create();
+    if (!table) return -1;
+    
+    /* counts temporarily holds the tag id of each name */
+    for (int i = 0; i < num_names; i++) {
+        counts[i] = names[i] ? bbcpp_tag_table_add(table, names[i]) : -1;
     }
     
-    int total_count = 0;
-    size_t child_count;
+    size_t local_counts[32];
+    size_t* counts_by_id = (num_names <= 32) ? local_counts : (size_t*)malloc((size_t)num_names * sizeof(size_t));
+    int result = -1;
     
-    if (bbcpp_document_get_children_count(doc, &child_count) == BBCPP_SUCCESS) {
-        for (size_t i = 0; i < child_count; i++) {
-            bbcpp_node_handle child;
-            if (bbcpp_document_get_child(doc, i, &child) == BBCPP_SUCCESS) {
-                total_count += count_tags_recursive(child, tag_name);
-            }
+    if (counts_by_id &&
+        bbcpp_tag_table_count(table, bbcode, strlen(bbcode), counts_by_id) == BBCPP_SUCCESS) {
+        for (int i = 0; i < num_names; i++) {
+            counts[i] = (counts[i] < 0) ? 0 : (int)counts_by_id[counts[i]];
         }
+        result = 0;
     }
     
-    bbcpp_document_destroy(doc);
-    return total_count;
+    if (counts_by_id != local_counts) free(counts_by_id);
+    bbcpp_tag_table_destroy(table);
+    return result;
 }
 
 int bbcpp_simple_extract_urls(const char* bbcode, char urls[][256], int max_urls) {
-    /* This would require more complex parsing to extract URLs from url tags */
-    /* For now, return 0 indicating no URLs found */
-    (void)bbcode; (void)urls; (void)max_urls; /* Suppress unused parameter warnings */
-    return 0;
+    if (!bbcode || !urls || max_urls <= 0) return 0;
+    
+    int found = scan_urls(bbcode, NULL, urls, max_urls);
+    return found < max_urls ? found : max_urls;
+}
+
+int bbcpp_simple_extract_url_spans(const char* bbcode, bbcpp_span* spans, int max_spans) {
+    if (!bbcode || (!spans && max_spans > 0)) return 0;
+    
+    return scan_urls(bbcode, spans, NULL, max_spans);
 }
 
 int bbcpp_simple_extract_quote_authors(const char* bbcode, char authors[][64], int max_authors) {
@@ -264,7 +345,7 @@ int bbcpp_simple_extract_quote_authors(const char* bbcode, char authors[][64], i
     
     int author_count = 0;
     /* This would require walking the tree and finding quote elements with user parameters */
-    /* Implementation left as exercise - would be similar to count_tags_recursive */
+    /* Implementation left as exercise - would be a bbcpp_document_traverse visitor like extract_text_visitor */
     
     bbcpp_document_destroy(doc);
     return author_count;
@@ -273,41 +354,274 @@ int bbcpp_simple_extract_quote_authors(const char* bbcode, char authors[][64], i
 int bbcpp_simple_validate(const char* bbcode, char* error_msg, size_t error_msg_size) {
     if (!bbcode) return 0;
     
-    bbcpp_document_handle doc = bbcpp_document_create();
-    if (!doc) {
-        if (error_msg && error_msg_size > 0) {
-            strncpy(error_msg, "Failed to create document", error_msg_size - 1);
-            error_msg[error_msg_size - 1] = '\0';
+    bbcpp_validation_result result;
+    int valid = bbcpp_simple_validate_ex(bbcode, &result);
+    
+    if (valid != 1 && error_msg && error_msg_size > 0) {
+        const char* reason = "Failed to validate document";
+        switch (result.error) {
+            case BBCPP_VALIDATION_MISMATCHED_CLOSE: reason = "Mismatched closing tag"; break;
+            case BBCPP_VALIDATION_UNEXPECTED_CLOSE: reason = "Unexpected closing tag"; break;
+            case BBCPP_VALIDATION_UNCLOSED: reason = "Unclosed tag"; break;
+            default: break;
+        }
+        
+        if (valid < 0) {
+            snprintf(error_msg, error_msg_size, "%s", reason);
+        } else {
+            snprintf(error_msg, error_msg_size, "%s at offset %lu", reason, (unsigned long)result.error_offset);
         }
-        return 0;
     }
     
-    bbcpp_error result = bbcpp_document_load(doc, bbcode);
-    bbcpp_document_destroy(doc);
+    return valid == 1;
+}
+
+/* An open tag on the validation stack: the hash of its folded name and its offset */
+typedef struct {
+    unsigned int id;
+    size_t offset;
+} open_tag;
+
+static unsigned int tag_id(const char* input, const bbcpp_span* name) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < name->length; i++) {
+        hash = (hash ^ (unsigned char)fold_case(input[name->offset + i])) * 16777619u;
+    }
+    return hash;
+}
+
+/* Checks that the opener at `tag` has the same name as `name`, the opener's name
+   starts right after its bracket and ends at the first non-alphanumeric char */
+static int opener_matches(const char* input, const open_tag* tag, unsigned int id, const bbcpp_span* name) {
+    if (tag->id != id) return 0;
+    
+    const char* opener = input + tag->offset + 1;
+    for (size_t i = 0; i < name->length; i++) {
+        if (fold_case(opener[i]) != fold_case(input[name->offset + i])) return 0;
+    }
     
-    if (result != BBCPP_SUCCESS) {
-        if (error_msg && error_msg_size > 0) {
-            strncpy(error_msg, bbcpp_error_string(result), error_msg_size - 1);
-            error_msg[error_msg_size - 1] = '\0';
+    char next = opener[name->length];
+    return !((next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z') || (next >= '0' && next <= '9'));
+}
+
+/* Tags that are never closed under the default schema: [hr], [br], [img=url],
+   and [*] which ends at the next item or at the end of its list */
+static int is_void_token(const bbcpp_token* token) {
+    switch (token->tag_id) {
+        case BBCPP_TAG_HR:
+        case BBCPP_TAG_BR:
+        case BBCPP_TAG_STAR:
+            return 1;
+        case BBCPP_TAG_IMG:
+            /* [img=url], not [img width=100]url[/img] */
+            return token->value.length > 0 && token->key.length == 0;
+        default:
+            return 0;
+    }
+}
+
+int bbcpp_simple_validate_ex(const char* bbcode, bbcpp_validation_result* result) {
+    if (!bbcode || !result) return -1;
+    
+    memset(result, 0, sizeof(bbcpp_validation_result));
+    
+    /* The stack starts out on the C stack and only moves to the heap for deep documents */
+    open_tag local_stack[64];
+    open_tag* stack = local_stack;
+    size_t capacity = sizeof(local_stack) / sizeof(local_stack[0]);
+    size_t depth = 0;
+    
+    bbcpp_tokenizer tokenizer;
+    bbcpp_token token;
+    bbcpp_tokenizer_init(&tokenizer, bbcode, strlen(bbcode));
+    
+    while (bbcpp_tokenizer_next(&tokenizer, &token)) {
+        if (token.type == BBCPP_TOKEN_ELEMENT && is_void_token(&token)) {
+            continue;
+        } else if (token.type == BBCPP_TOKEN_ELEMENT) {
+            if (depth == capacity) {
+                open_tag* grown = (open_tag*)malloc(capacity * 2 * sizeof(open_tag));
+                if (!grown) {
+                    if (stack != local_stack) free(stack);
+                    return -1;
+                }
+                memcpy(grown, stack, depth * sizeof(open_tag));
+                if (stack != local_stack) free(stack);
+                stack = grown;
+                capacity *= 2;
+            }
+            
+            stack[depth].id = tag_id(bbcode, &token.name);
+            stack[depth].offset = token.source.offset;
+            depth++;
+            
+            /* what looks like tags inside [code] is text, as in load() */
+            bbcpp_tokenizer_skip_raw(&tokenizer, &token, NULL);
+        } else if (token.type == BBCPP_TOKEN_CLOSING) {
+            unsigned int id = tag_id(bbcode, &token.name);
+            
+            if (depth > 0 && opener_matches(bbcode, &stack[depth - 1], id, &token.name)) {
+                depth--;
+                continue;
+            }
+            
+            /* Find the opener further down the stack, the tags above it are
+               treated as closed by this tag so one mistake is reported once */
+            size_t match = depth;
+            while (match > 0 && !opener_matches(bbcode, &stack[match - 1], id, &token.name)) {
+                match--;
+            }
+            
+            if (result->error == BBCPP_VALIDATION_OK) {
+                result->error = (match > 0) ? BBCPP_VALIDATION_MISMATCHED_CLOSE : BBCPP_VALIDATION_UNEXPECTED_CLOSE;
+                result->error_offset = token.source.offset;
+            }
+            
+            if (match > 0) depth = match - 1;
         }
-        return 0;
     }
     
-    return 1; /* Valid */
+    result->unclosed_count = (int)depth;
+    for (size_t i = 0; i < depth && i < BBCPP_MAX_REPORTED_UNCLOSED; i++) {
+        result->unclosed_offsets[i] = stack[i].offset;
+    }
+    
+    if (result->error == BBCPP_VALIDATION_OK && depth > 0) {
+        result->error = BBCPP_VALIDATION_UNCLOSED;
+        result->error_offset = stack[depth - 1].offset;
+    }
+    
+    if (stack != local_stack) free(stack);
+    return result->error == BBCPP_VALIDATION_OK;
 }
 
 int bbcpp_simple_strip_tag(const char* bbcode, const char* tag_name, char* output, size_t output_size) {
-    /* This would require filtering out specific tags while keeping content */
-    /* For now, just copy the raw text */
-    return bbcpp_simple_get_text(bbcode, output, output_size);
+    if (!bbcode || !tag_name || !output || output_size == 0) return -1;
+    
+    bbcpp_tokenizer tokenizer;
+    bbcpp_token token;
+    size_t pos = 0;
+    
+    bbcpp_tokenizer_init(&tokenizer, bbcode, strlen(bbcode));
+    
+    /* Everything but the opening and closing tags of tag_name is copied as is, and
+       so is the content of [code] */
+    while (bbcpp_tokenizer_next(&tokenizer, &token)) {
+        bbcpp_span raw;
+        if (token.type == BBCPP_TOKEN_TEXT || !span_equals_name(bbcode, &token.name, tag_name)) {
+            append_output(output, &pos, output_size, bbcode + token.source.offset, token.source.length);
+        }
+        if (bbcpp_tokenizer_skip_raw(&tokenizer, &token, &raw)) {
+            append_output(output, &pos, output_size, bbcode + raw.offset, raw.length);
+        }
+    }
+    
+    output[pos] = '\0';
+    return 0;
 }
 
 int bbcpp_simple_replace_tags(const char* bbcode, const bbcpp_tag_replacement* replacements, 
                              int num_replacements, char* output, size_t output_size) {
-    /* This would require custom tag replacement logic */
-    /* For now, just return the original text */
-    (void)replacements; (void)num_replacements; /* Suppress unused parameter warnings */
-    return bbcpp_simple_get_text(bbcode, output, output_size);
+    if (!bbcode || !output || output_size == 0) return -1;
+    
+    bbcpp_replacement_table_handle table = bbcpp_simple_compile_replacements(replacements, num_replacements);
+    if (!table) return -1;
+    
+    int result = bbcpp_simple_replace_tags_compiled(bbcode, table, output, output_size);
+    bbcpp_simple_free_replacements(table);
+    return result;
+}
+
+bbcpp_replacement_table_handle bbcpp_simple_compile_replacements(const bbcpp_tag_replacement* replacements,
+                                                                 int num_replacements) {
+    if (num_replacements < 0 || (!replacements && num_replacements > 0)) return NULL;
+    
+    bbcpp_replacement_table_handle table = (bbcpp_replacement_table_handle)calloc(1, sizeof(*table));
+    if (!table) return NULL;
+    
+    table->tags = bbcpp_tag_table_create();
+    table->entries = (compiled_replacement*)calloc(num_replacements > 0 ? (size_t)num_replacements : 1,
+                                                   sizeof(compiled_replacement));
+    if (!table->tags || !table->entries) {
+        bbcpp_simple_free_replacements(table);
+        return NULL;
+    }
+    
+    for (int i = 0; i < num_replacements; i++) {
+        if (!replacements[i].tag_name) continue;
+        
+        int id = bbcpp_tag_table_add(table->tags, replacements[i].tag_name);
+        if (id < 0) {
+            bbcpp_simple_free_replacements(table);
+            return NULL;
+        }
+        
+        /* a repeated tag name replaces the earlier entry */
+        compiled_replacement* entry = &table->entries[id];
+        free(entry->open);
+        free(entry->close);
+        entry->open = copy_text(replacements[i].open_replacement, &entry->open_length);
+        entry->close = copy_text(replacements[i].close_replacement, &entry->close_length);
+        if (!entry->open || !entry->close) {
+            bbcpp_simple_free_replacements(table);
+            return NULL;
+        }
+        
+        if (id >= table->count) table->count = id + 1;
+    }
+    
+    return table;
+}
+
+void bbcpp_simple_free_replacements(bbcpp_replacement_table_handle table) {
+    if (!table) return;
+    
+    if (table->entries) {
+        for (int i = 0; i < table->count; i++) {
+            free(table->entries[i].open);
+            free(table->entries[i].close);
+        }
+        free(table->entries);
+    }
+    
+    bbcpp_tag_table_destroy(table->tags);
+    free(table);
+}
+
+int bbcpp_simple_replace_tags_compiled(const char* bbcode, bbcpp_replacement_table_handle table,
+                                       char* output, size_t output_size) {
+    if (!bbcode || !table || !output || output_size == 0) return -1;
+    
+    bbcpp_tokenizer tokenizer;
+    bbcpp_token token;
+    size_t pos = 0;
+    
+    bbcpp_tokenizer_init(&tokenizer, bbcode, strlen(bbcode));
+    
+    /* Tags found in the table are rewritten, everything else is copied as is, and so
+       is the content of [code] */
+    while (bbcpp_tokenizer_next(&tokenizer, &token)) {
+        bbcpp_span raw;
+        int id = -1;
+        if (token.type != BBCPP_TOKEN_TEXT) {
+            id = bbcpp_tag_table_find(table->tags, bbcode + token.name.offset, token.name.length);
+        }
+        
+        if (id < 0) {
+            append_output(output, &pos, output_size, bbcode + token.source.offset, token.source.length);
+        } else if (token.type == BBCPP_TOKEN_ELEMENT) {
+            append_output(output, &pos, output_size, table->entries[id].open, table->entries[id].open_length);
+        } else {
+            append_output(output, &pos, output_size, table->entries[id].close, table->entries[id].close_length);
+        }
+        
+        if (bbcpp_tokenizer_skip_raw(&tokenizer, &token, &raw)) {
+            append_output(output, &pos, output_size, bbcode + raw.offset, raw.length);
+        }
+    }
+    
+    output[pos] = '\0';
+    return 0;
 }
 
 int bbcpp_simple_get_stats(const char* bbcode, bbcpp_stats* stats) {
@@ -323,16 +637,61 @@ int bbcpp_simple_get_stats(const char* bbcode, bbcpp_stats* stats) {
         return -1;
     }
     
-    /* Basic stats - could be expanded with recursive tree walking */
-    size_t child_count;
-    if (bbcpp_document_get_children_count(doc, &child_count) == BBCPP_SUCCESS) {
-        stats->total_tags = (int)child_count;
+    /* The counters are maintained by the parser, so no tree walk is needed */
+    bbcpp_document_stats doc_stats;
+    if (bbcpp_document_get_stats(doc, &doc_stats) == BBCPP_SUCCESS) {
+        stats->total_tags = (int)doc_stats.element_count;
+        stats->text_nodes = (int)doc_stats.text_node_count;
+        stats->unique_tags = (int)doc_stats.unique_tags;
+        stats->max_nesting_depth = (int)doc_stats.max_depth;
+        stats->total_text_length = doc_stats.text_length;
     }
     
     bbcpp_document_destroy(doc);
     return 0;
 }
 
+int bbcpp_simple_get_tag_histogram(const char* bbcode, bbcpp_tag_count* entries, int max_entries) {
+    if (!bbcode || (!entries && max_entries > 0)) return -1;
+    
+    bbcpp_document_handle doc = bbcpp_document_create();
+    if (!doc) return -1;
+    
+    if (bbcpp_document_load(doc, bbcode) != BBCPP_SUCCESS) {
+        bbcpp_document_destroy(doc);
+        return -1;
+    }
+    
+    size_t unique_tags = 0;
+    bbcpp_document_get_tag_histogram(doc, NULL, 0, &unique_tags);
+    
+    size_t filled = max_entries <= 0 ? 0 : (size_t)max_entries < unique_tags ? (size_t)max_entries : unique_tags;
+    
+    bbcpp_tag_histogram_entry* histogram = NULL;
+    if (filled > 0) {
+        histogram = (bbcpp_tag_histogram_entry*)malloc(filled * sizeof(bbcpp_tag_histogram_entry));
+        if (!histogram || bbcpp_document_get_tag_histogram(doc, histogram, filled, &unique_tags) != BBCPP_SUCCESS) {
+            free(histogram);
+            bbcpp_document_destroy(doc);
+            return -1;
+        }
+    }
+    
+    for (size_t i = 0; i < filled; i++) {
+        /* names that do not fit are reported empty but still counted */
+        if (histogram[i].name_length < sizeof(entries[i].tag_name)) {
+            memcpy(entries[i].tag_name, histogram[i].name, histogram[i].name_length + 1);
+        } else {
+            entries[i].tag_name[0] = '\0';
+        }
+        entries[i].count = (int)histogram[i].count;
+    }
+    
+    free(histogram);
+    bbcpp_document_destroy(doc);
+    return (int)unique_tags;
+}
+
 const char* bbcpp_simple_version(void) {
     return "BBCode C Simple API v1.0";
 }
@@ -7,7 +7,9 @@ extern "C" {
 
 #include "bbcpp_c.h"
 
-/* Simplified high-level functions for common BBCode operations */
+/* Simplified high-level functions for common BBCode operations. The ones that stream over
+   the tokenizer treat the content of [code] and [noparse] as text, as bbcpp_document_load()
+   does: tags inside it are not counted, validated, stripped, replaced or linked. */
 
 /* Parse BBCode and return the raw text content (strips all formatting) */
 int bbcpp_simple_get_text(const char* bbcode, char* output, size_t output_size);
@@ -15,21 +17,54 @@ int bbcpp_simple_get_text(const char* bbcode, char* output, size_t output_size);
 /* Parse BBCode and convert to HTML */
 int bbcpp_simple_to_html(const char* bbcode, char* output, size_t output_size);
 
+/* Same as the two above, answered from cache when the same input was rendered
+   before (see bbcpp_render_cache_create). cache may be shared between threads,
+   NULL renders without caching. */
+int bbcpp_simple_get_text_cached(bbcpp_render_cache_handle cache, const char* bbcode, char* output, size_t output_size);
+int bbcpp_simple_to_html_cached(bbcpp_render_cache_handle cache, const char* bbcode, char* output, size_t output_size);
+
 /* Check if BBCode contains specific tags */
 int bbcpp_simple_has_tag(const char* bbcode, const char* tag_name);
 
 /* Count occurrences of a specific tag */
 int bbcpp_simple_count_tags(const char* bbcode, const char* tag_name);
 
-/* Extract all URLs from BBCode */
+/* Count occurrences of several tags in a single pass, counts[i] receives the count of names[i] */
+int bbcpp_simple_count_tags_multi(const char* bbcode, const char** names, int num_names, int* counts);
+
+/* Extract all URLs from BBCode ([url=...], [url]...[/url] and [img]...[/img]) */
 int bbcpp_simple_extract_urls(const char* bbcode, char urls[][256], int max_urls);
 
+/* Same as above without copying: each URL is reported as a span into bbcode.
+   Returns the number of URLs found, at most max_spans of them are written */
+int bbcpp_simple_extract_url_spans(const char* bbcode, bbcpp_span* spans, int max_spans);
+
 /* Extract all quote authors */
 int bbcpp_simple_extract_quote_authors(const char* bbcode, char authors[][64], int max_authors);
 
 /* Validate BBCode structure (check for matching opening/closing tags) */
 int bbcpp_simple_validate(const char* bbcode, char* error_msg, size_t error_msg_size);
 
+/* Detailed structural validation, runs over the tokenizer without building a tree */
+typedef enum {
+    BBCPP_VALIDATION_OK = 0,
+    BBCPP_VALIDATION_MISMATCHED_CLOSE = 1,  /* [b][i]text[/b] */
+    BBCPP_VALIDATION_UNEXPECTED_CLOSE = 2,  /* [/b] with no open [b] */
+    BBCPP_VALIDATION_UNCLOSED = 3           /* [b] without [/b] */
+} bbcpp_validation_error;
+
+#define BBCPP_MAX_REPORTED_UNCLOSED 16
+
+typedef struct {
+    bbcpp_validation_error error;   /* the first problem found */
+    size_t error_offset;            /* byte offset of the tag that caused it */
+    int unclosed_count;             /* number of tags still open at the end */
+    size_t unclosed_offsets[BBCPP_MAX_REPORTED_UNCLOSED];  /* outermost first */
+} bbcpp_validation_result;
+
+/* Returns 1 if the structure is valid, 0 if not and -1 on error */
+int bbcpp_simple_validate_ex(const char* bbcode, bbcpp_validation_result* result);
+
 /* Strip specific tags while keeping content */
 int bbcpp_simple_strip_tag(const char* bbcode, const char* tag_name, char* output, size_t output_size);
 
@@ -43,6 +78,16 @@ typedef struct {
 int bbcpp_simple_replace_tags(const char* bbcode, const bbcpp_tag_replacement* replacements, 
                              int num_replacements, char* output, size_t output_size);
 
+/* Compile a replacement table once and reuse it for any number of documents.
+   The replacement strings are copied, so the source array may be released. */
+typedef struct bbcpp_replacement_table_t* bbcpp_replacement_table_handle;
+
+bbcpp_replacement_table_handle bbcpp_simple_compile_replacements(const bbcpp_tag_replacement* replacements,
+                                                                 int num_replacements);
+void bbcpp_simple_free_replacements(bbcpp_replacement_table_handle table);
+int bbcpp_simple_replace_tags_compiled(const char* bbcode, bbcpp_replacement_table_handle table,
+                                       char* output, size_t output_size);
+
 /* Get statistics about BBCode content */
 typedef struct {
     int total_tags;
@@ -54,6 +99,14 @@ typedef struct {
 
 int bbcpp_simple_get_stats(const char* bbcode, bbcpp_stats* stats);
 
+/* Per-tag histogram; returns the number of distinct tags and fills at most max_entries */
+typedef struct {
+    char tag_name[64];
+    int count;
+} bbcpp_tag_count;
+
+int bbcpp_simple_get_tag_histogram(const char* bbcode, bbcpp_tag_count* entries, int max_entries);
+
 /* Utility functions */
 const char* bbcpp_simple_version(void);
 void bbcpp_simple_set_debug(int enable);
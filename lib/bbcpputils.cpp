@@ -45,28 +45,37 @@ std::string getIndentString(const unsigned int indent)
 
 void printChildren(const BBNode& parent, unsigned int indent)
 {
-    for (const auto node : parent.getChildren())
+    traverse(parent, [indent](const BBNode& node, std::size_t depth)
     {
-        switch (node->getNodeType())
+        const auto nodeIndent = indent + static_cast<unsigned int>(depth);
+
+        switch (node.getNodeType())
         {
             default:
                 break;
                 
             case BBNode::NodeType::ELEMENT:
             {
-                const auto element = node->downCast<BBElementPtr>();
+                const auto& element = static_cast<const BBElement&>(node);
                 std::cout
-                << getIndentString(indent)
+                << getIndentString(nodeIndent)
                 << "["
-                << (element->getElementType() == BBElement::CLOSING ? "/" : "")
-                << element->getNodeName() << "]"
+                << (element.getElementType() == BBElement::CLOSING ? "/" : "")
+                << element.getNodeName() << "]"
                 << std::endl;
                 
-                if (element->getElementType() == BBElement::PARAMETER)
+                if (element.getElementType() == BBElement::VALUE)
+                {
+                    std::cout
+                        << getIndentString(nodeIndent + 1)
+                        << "=" << element.getValue()
+                        << std::endl;
+                }
+                else if (element.getElementType() == BBElement::PARAMETER)
                 {
                     std::cout 
-                        << getIndentString(indent + 1)
-                        << element->getParameters()
+                        << getIndentString(nodeIndent + 1)
+                        << element.getParameters()
                         << std::endl;
                 }
             }
@@ -74,16 +83,16 @@ void printChildren(const BBNode& parent, unsigned int indent)
                 
             case BBNode::NodeType::TEXT:
             {
-                const auto textnode = node->downCast<BBTextPtr>();
-                std::cout << getIndentString(indent)
-                << "@\"" << textnode->getText() << "\""
+                const auto& textnode = static_cast<const BBText&>(node);
+                std::cout << getIndentString(nodeIndent)
+                << "@\"" << textnode.getText() << "\""
                 << std::endl;
             }
                 break;
         }
-        
-        printChildren(*node, indent+1);
-    }
+
+        return VisitResult::CONTINUE;
+    });
 }
 
 void printDocument(const BBDocument& doc)
@@ -97,35 +106,62 @@ void printDocument(const BBDocument& doc)
 std::string getRawString(const BBNode& parent)
 {
     std::string root = "";
-    for (const auto node : parent.getChildren())
+    traverse(parent, [&root](const BBNode& node, std::size_t)
     {
-        switch (node->getNodeType())
+        if (node.getNodeType() == BBNode::NodeType::TEXT)
         {
-            default:
-                break;
-                    
-            case BBNode::NodeType::ELEMENT:
-            {
-                const auto element = node->downCast<BBElementPtr>();
-                    
-                if (element->getElementType() == BBElement::PARAMETER)
-                {
-                }
-            }
-                break;
-                    
-            case BBNode::NodeType::TEXT:
+            root += node.getNodeName();
+        }
+
+        return VisitResult::CONTINUE;
+    });
+
+    return root;
+}
+
+std::vector<std::size_t> countTags(std::string_view bbcode, const std::vector<std::string>& names)
+{
+    BBTagTable tags;
+    for (const auto& name : names)
+    {
+        tags.intern(name);
+    }
+
+    std::vector<std::size_t> countsById;
+    countTags(bbcode, tags, countsById);
+
+    std::vector<std::size_t> counts;
+    counts.reserve(names.size());
+    for (const auto& name : names)
+    {
+        counts.push_back(countsById[tags.find(name)]);
+    }
+
+    return counts;
+}
+
+void countTags(std::string_view bbcode, const BBTagTable& tags, std::vector<std::size_t>& counts)
+{
+    counts.assign(tags.size(), 0);
+
+    BBTokenizer tokenizer(bbcode);
+    BBToken token;
+    std::string_view raw;
+
+    while (tokenizer.next(token))
+    {
+        if (token.type == BBToken::Type::ELEMENT)
+        {
+            const auto id = tags.find(token.name);
+            if (id != BBTagTable::npos)
             {
-                const auto textnode = node->downCast<BBTextPtr>();
-                root += textnode->getText();
+                counts[id]++;
             }
-                break;
+
+            // tags inside [code] are text to load()
+            tokenizer.skipRaw(token, raw);
         }
-            
-        root += getRawString(*node);
     }
-
-return root;
 }
 
 } // namespace
@@ -5,6 +5,76 @@
 namespace bbcpp
 {
 
+enum class VisitResult
+{
+    CONTINUE,
+    SKIP_CHILDREN,  // from `enter`: do not visit this node's children, `leave` is still called
+    STOP            // end the traversal
+};
+
+// Walks every node below `root` in document order with an explicit stack, so
+// deep documents cannot overflow the call stack. `enter(node, depth)` is
+// called before a node's children (pre-order) and `leave(node, depth)` after
+// them (post-order); the children of `root` have depth 0. Returns false if a
+// callback stopped the walk.
+template<typename EnterT, typename LeaveT>
+bool traverse(const BBNode& root, EnterT&& enter, LeaveT&& leave)
+{
+    struct Frame
+    {
+        const BBNodeList*   children;
+        std::size_t         next;
+    };
+
+    std::vector<Frame> stack;
+    stack.push_back(Frame{ &root.getChildren(), 0 });
+
+    while (!stack.empty())
+    {
+        auto& frame = stack.back();
+        if (frame.next == frame.children->size())
+        {
+            stack.pop_back();
+            if (!stack.empty())
+            {
+                const auto& parent = *(*stack.back().children)[stack.back().next - 1];
+                if (leave(parent, stack.size() - 1) == VisitResult::STOP)
+                {
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        const auto& node = *(*frame.children)[frame.next++];
+        const auto depth = stack.size() - 1;
+        const auto result = enter(node, depth);
+
+        if (result == VisitResult::STOP)
+        {
+            return false;
+        }
+        else if (result == VisitResult::CONTINUE && !node.getChildren().empty())
+        {
+            stack.push_back(Frame{ &node.getChildren(), 0 });
+        }
+        else if (leave(node, depth) == VisitResult::STOP)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// pre-order only
+template<typename EnterT>
+bool traverse(const BBNode& root, EnterT&& enter)
+{
+    return traverse(root, std::forward<EnterT>(enter),
+        [](const BBNode&, std::size_t) { return VisitResult::CONTINUE; });
+}
+
 // Helper Functions
 std::string nodeTypeToString(BBNode::NodeType type);
 std::string getIndentString(const unsigned int indent);
@@ -12,4 +82,9 @@ void printChildren(const BBNode& parent, unsigned int indent);
 void printDocument(const BBDocument& doc);
 std::string getRawString(const BBNode& node);
 
+// Counts opening tags of each name with a single tokenizer pass. The second
+// form takes a prepared table and fills `counts` indexed by tag id.
+std::vector<std::size_t> countTags(std::string_view bbcode, const std::vector<std::string>& names);
+void countTags(std::string_view bbcode, const BBTagTable& tags, std::vector<std::size_t>& counts);
+
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+// Built with -fno-exceptions against bbcppnoexcept, so it checks that the
+// library links and answers through its exception-free calls. Boost.Test
+// needs exceptions, hence the plain checks.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../lib/BBDocument.h"
+#include "../lib/BBFrozenDocument.h"
+#include "../lib/bbcpp_c.h"
+#include "../lib/bbcpp_simple.h"
+
+namespace
+{
+
+int failures = 0;
+
+void check(bool condition, const char* what)
+{
+    if (!condition)
+    {
+        std::printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+#define CHECK(condition) check((condition), #condition)
+
+void documentTest()
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    CHECK(doc->tryLoad("[quote=Bob;1234][style color=red]x[/style][/quote]") == BBStatus::OK);
+
+    const auto quote = doc->getChildren()[0]->downCast<BBElementPtr>(false);
+    CHECK(quote != nullptr);
+
+    std::string_view found;
+    CHECK(quote->findValueField(1, found) && found == "1234");
+    CHECK(!quote->findValueField(2, found));
+
+    const auto style = quote->getChildren()[0]->downCast<BBElementPtr>(false);
+    CHECK(style->findParameter("color", found) && found == "red");
+    CHECK(!style->findParameter("size", found));
+
+    bool incremental = false;
+    CHECK(doc->tryApplyEdit(doc->getSource().size() + 1, 0, "x", incremental) == BBStatus::OUT_OF_RANGE);
+    CHECK(doc->tryApplyEdit(0, 0, "a", incremental) == BBStatus::OK);
+
+    const auto buffer = doc->serialize();
+    BBFrozenDocumentPtr frozen;
+    CHECK(BBFrozenDocument::tryDeserialize(buffer.data(), buffer.size(), frozen) == BBStatus::OK);
+    CHECK(BBFrozenDocument::tryDeserialize(buffer.data(), buffer.size() - 1, frozen) == BBStatus::INVALID_FORMAT);
+}
+
+void cApiTest()
+{
+    bbcpp_document_handle doc = bbcpp_document_create();
+    CHECK(bbcpp_document_load(doc, "[style color=red]x[/style]") == BBCPP_SUCCESS);
+
+    bbcpp_node_handle style;
+    CHECK(bbcpp_document_get_child(doc, 0, &style) == BBCPP_SUCCESS);
+
+    char buffer[16];
+    size_t length = 0;
+    int has = 1;
+    CHECK(bbcpp_element_get_parameter(style, "color", buffer, sizeof(buffer), &length) == BBCPP_SUCCESS);
+    CHECK(std::strcmp(buffer, "red") == 0);
+    CHECK(bbcpp_element_get_parameter(style, "size", buffer, sizeof(buffer), &length) == BBCPP_ERROR_NOT_FOUND);
+    CHECK(bbcpp_element_has_parameter(style, "size", &has) == BBCPP_SUCCESS && has == 0);
+
+    bbcpp_node_destroy(style);
+    bbcpp_document_destroy(doc);
+}
+
+void simpleTest()
+{
+    char output[64];
+    CHECK(bbcpp_simple_to_html("[b]x[/b]", output, sizeof(output)) == 0);
+    CHECK(std::strcmp(output, "<strong>x</strong>") == 0);
+    CHECK(bbcpp_simple_count_tags("[b]a[/b][code][b][/code]", "b") == 1);
+    CHECK(bbcpp_simple_validate("[b]x[/b]", output, sizeof(output)) == 1);
+
+    bbcpp_stats stats;
+    CHECK(bbcpp_simple_get_stats("[b]a[/b][i]b[/i]", &stats) == 0 && stats.unique_tags == 2);
+}
+
+} // namespace
+
+int main()
+{
+    documentTest();
+    cApiTest();
+    simpleTest();
+
+    if (failures == 0)
+    {
+        std::printf("no errors detected\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -14,4 +14,306 @@ BOOST_AUTO_TEST_CASE(constructionTest)
     BOOST_CHECK(node.getNodeName() == "QUOTE");
 }
 
+BOOST_AUTO_TEST_CASE(closeMatchingTest)
+{
+    using namespace bbcpp;
+
+    // a closer closes the innermost open element of its tag, and the
+    // elements opened after that one end where it starts
+    auto doc = BBDocument::create();
+    doc->load("[b][i]x[/B]y");
+
+    const auto& children = doc->getChildren();
+    BOOST_REQUIRE_EQUAL(children.size(), 2u);
+
+    const auto bold = children[0];
+    BOOST_REQUIRE_EQUAL(bold->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(bold->getChildren()[1]->getNodeName(), "B");
+    BOOST_CHECK_EQUAL(doc->getSource(bold->getCloseTagSpan()), "[/B]");
+
+    const auto italic = bold->getChildren()[0];
+    BOOST_CHECK_EQUAL(italic->getNodeName(), "i");
+    BOOST_CHECK_EQUAL(doc->getSource(italic->getSourceSpan()), "[i]x");
+    BOOST_CHECK(italic->getCloseTagSpan().empty());
+
+    BOOST_CHECK_EQUAL(children[1]->downCast<BBTextPtr>()->getText(), "y");
+
+    // a closer with nothing to close is text
+    doc = BBDocument::create();
+    doc->load("a[/b]c[quote]d[/i][/quote]");
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[0]->downCast<BBTextPtr>()->getText(), "a[/b]c");
+
+    const auto quote = doc->getChildren()[1];
+    BOOST_REQUIRE_EQUAL(quote->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(quote->getChildren()[0]->downCast<BBTextPtr>()->getText(), "d[/i]");
+    BOOST_CHECK_EQUAL(doc->getStats().closingCount, 1u);
+
+    // nested elements of the same tag close innermost first
+    doc = BBDocument::create();
+    doc->load("[quote][quote]x[/quote]y[/quote]z");
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[0]->getChildren().size(), 3u);
+
+    // later loads still see the elements left open
+    doc = BBDocument::create();
+    doc->load("[spoiler][b]x");
+    doc->load("[/SPOILER]y");
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getSource(doc->getChildren()[0]->getCloseTagSpan()), "[/SPOILER]");
+}
+
+BOOST_AUTO_TEST_CASE(rawContentTest)
+{
+    using namespace bbcpp;
+
+    // the content of a raw tag is one text node, tags and all
+    auto doc = BBDocument::create();
+    doc->load("[code]a[i] = [b];[/b][/CODE][b]x[/b]");
+
+    const auto& children = doc->getChildren();
+    BOOST_REQUIRE_EQUAL(children.size(), 2u);
+    BOOST_REQUIRE_EQUAL(children[0]->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(children[0]->getChildren()[0]->downCast<BBTextPtr>()->getText(), "a[i] = [b];[/b]");
+    BOOST_CHECK_EQUAL(children[1]->getNodeName(), "b");
+    BOOST_CHECK_EQUAL(doc->getStats().elementCount, 2u);
+
+    // an unclosed raw tag runs to the end, and a later load continues it
+    doc = BBDocument::create();
+    doc->load("[noparse=x][b]");
+    doc->load("[/b][/noparse]y");
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[0]->getChildren()[0]->downCast<BBTextPtr>()->getText(), "[b][/b]");
+
+    // the raw tags are configurable
+    ParseOptions options;
+    options.rawTags = { "Math" };
+    doc = BBDocument::create();
+    doc->load("[code][b]x[/b][/code][math][b][/MATH]", options);
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[0]->getChildren()[0]->getNodeName(), "b");
+    BOOST_CHECK_EQUAL(doc->getChildren()[1]->getChildren()[0]->downCast<BBTextPtr>()->getText(), "[b]");
+}
+
+BOOST_AUTO_TEST_CASE(valueElementTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("[quote=Bob;1234]a[/quote][color=red]b[/color][size=;]c");
+
+    const auto& children = doc->getChildren();
+    BOOST_REQUIRE_EQUAL(children.size(), 3u);
+
+    const auto quote = children[0]->downCast<BBElementPtr>();
+    BOOST_CHECK_EQUAL(quote->getElementType(), BBElement::VALUE);
+    BOOST_CHECK_EQUAL(quote->getTagId(), BBTag::QUOTE);
+    BOOST_CHECK_EQUAL(quote->getValue(), "Bob;1234");
+    BOOST_CHECK(quote->getParameters().empty());
+    BOOST_REQUIRE_EQUAL(quote->getValueFieldCount(), 2u);
+    BOOST_CHECK_EQUAL(quote->getValueField(0), "Bob");
+    BOOST_CHECK_EQUAL(quote->getValueField(1), "1234");
+    BOOST_CHECK_THROW(quote->getValueField(2), std::out_of_range);
+
+    const auto color = children[1]->downCast<BBElementPtr>();
+    BOOST_CHECK_EQUAL(color->getValueFieldCount(), 1u);
+    BOOST_CHECK_EQUAL(color->getValueField(0), "red");
+
+    // empty fields are kept
+    const auto size = children[2]->downCast<BBElementPtr>();
+    BOOST_REQUIRE_EQUAL(size->getValueFieldCount(), 2u);
+    BOOST_CHECK_EQUAL(size->getValueField(1), "");
+
+    // an unquoted value runs to the bracket, so a query string stays in the url
+    doc = BBDocument::create();
+    doc->load("[url=http://x/?a=b&c=%20]a[/url][style href=http://x/?a=b size=3]b[/style]");
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    const auto url = doc->getChildren()[0]->downCast<BBElementPtr>();
+    BOOST_CHECK_EQUAL(url->getElementType(), BBElement::VALUE);
+    BOOST_CHECK_EQUAL(url->getValue(), "http://x/?a=b&c=%20");
+    const auto style = doc->getChildren()[1]->downCast<BBElementPtr>();
+    BOOST_CHECK_EQUAL(style->getParameters().size(), 2u);
+    BOOST_CHECK_EQUAL(style->getParameter("href"), "http://x/?a=b");
+
+    ParseOptions strict;
+    strict.strictAttributes = true;
+    doc->load("[url=http://x/?a=b&c=%20]a[/url]", strict);
+    BOOST_CHECK_EQUAL(doc->getChildren().back()->downCast<BBElementPtr>()->getValue(), "http://x/?a=b&c=%20");
+
+    // named parameters still go into the parameter map
+    doc = BBDocument::create();
+    doc->load("[quote user=Bob]a[/quote]");
+    const auto named = doc->getChildren()[0]->downCast<BBElementPtr>();
+    BOOST_CHECK_EQUAL(named->getElementType(), BBElement::PARAMETER);
+    BOOST_CHECK(named->getValue().empty());
+    BOOST_CHECK_EQUAL(named->getValueFieldCount(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(statusTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    BOOST_CHECK(doc->tryLoad("[style color=red]a[/style]b") == BBStatus::OK);
+
+    // the find...() accessors report a miss instead of throwing
+    const auto& children = doc->getChildren();
+    BOOST_REQUIRE_EQUAL(children.size(), 2u);
+    const auto style = children[0]->downCast<BBElementPtr>();
+    std::string_view found;
+    BOOST_CHECK(style->findParameter("color", found));
+    BOOST_CHECK_EQUAL(found, "red");
+    BOOST_CHECK(!style->findParameter("size", found));
+    BOOST_CHECK_EQUAL(style->getParameter("size", false), "");
+    BOOST_CHECK_EQUAL(children[1]->downCast<BBElementPtr>(false), BBElementPtr());
+
+    doc = BBDocument::create();
+    doc->load("[quote=Bob;1234]a[/quote]");
+    const auto quote = doc->getChildren()[0]->downCast<BBElementPtr>();
+    BOOST_CHECK(quote->findValueField(1, found));
+    BOOST_CHECK_EQUAL(found, "1234");
+    BOOST_CHECK(!quote->findValueField(2, found));
+    BOOST_CHECK_EQUAL(found, "1234");
+
+    // a cap that stops the load is reported for that load only
+    ParseOptions options;
+    options.limits.maxNodes = 2;
+    BOOST_CHECK(doc->tryLoad("[b]x[/b]", options) == BBStatus::TRUNCATED);
+    BOOST_CHECK(doc->getStats().truncated);
+    BOOST_CHECK(doc->tryLoad("y") == BBStatus::OK);
+    BOOST_CHECK(doc->getStats().truncated);
+
+    BOOST_CHECK_EQUAL(statusName(BBStatus::SOURCE_TOO_LARGE), "source too large");
+}
+
+BOOST_AUTO_TEST_CASE(typedValueTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("[color=#f00]a[/color][color=#ff000080]b[/color][color=Red]c[/color][color=#ff00f]d[/color]"
+              "[size=12]e[/size][quote=Bob;1234]f[/quote][size=12px]g[/size]"
+              "[url=\"  http://x.org/a?b=1 \"]h[/url][url=javascript:alert(1)]i[/url][url=/local]j[/url]");
+
+    const auto& children = doc->getChildren();
+    BOOST_REQUIRE_EQUAL(children.size(), 10u);
+    const auto element = [&children](std::size_t index) { return children[index]->downCast<BBElementPtr>(); };
+
+    std::uint32_t rgba = 0;
+    BOOST_CHECK(element(0)->getColor(rgba));
+    BOOST_CHECK_EQUAL(rgba, 0xff0000ffu);
+    BOOST_CHECK(element(1)->getColor(rgba));
+    BOOST_CHECK_EQUAL(rgba, 0xff000080u);
+    BOOST_CHECK(element(2)->getColor(rgba));
+    BOOST_CHECK_EQUAL(rgba, 0xff0000ffu);
+
+    // a failed read leaves the output alone, and asking again gives the same answer
+    rgba = 7;
+    BOOST_CHECK(!element(3)->getColor(rgba));
+    BOOST_CHECK(!element(3)->getColor(rgba));
+    BOOST_CHECK_EQUAL(rgba, 7u);
+
+    std::int64_t integer = 0;
+    BOOST_CHECK(element(4)->getInteger(integer));
+    BOOST_CHECK_EQUAL(integer, 12);
+    BOOST_CHECK(element(5)->getInteger(integer));
+    BOOST_CHECK_EQUAL(integer, 1234);
+    BOOST_CHECK(!element(6)->getInteger(integer));
+    BOOST_CHECK(!element(4)->getColor(rgba));
+
+    std::string_view url;
+    BOOST_CHECK(element(7)->getUrl(url));
+    BOOST_CHECK_EQUAL(url, "http://x.org/a?b=1");
+    BOOST_CHECK(element(7)->getUrl(url));
+    BOOST_CHECK_EQUAL(url.data(), element(7)->getValue().data() + 2);
+    BOOST_CHECK(!element(8)->getUrl(url));
+    BOOST_CHECK(element(9)->getUrl(url));
+    BOOST_CHECK_EQUAL(url, "/local");
+
+    // the decoders on their own
+    BOOST_CHECK(DecodeColor("transparent", rgba));
+    BOOST_CHECK_EQUAL(rgba, 0u);
+    BOOST_CHECK(!DecodeColor("#12345g", rgba));
+    BOOST_CHECK(DecodeInteger("-5", integer));
+    BOOST_CHECK_EQUAL(integer, -5);
+    BOOST_CHECK(!DecodeInteger("99999999999999999999", integer));
+    BOOST_CHECK(!DecodeInteger("", integer));
+    BOOST_CHECK(DecodeUrl("mailto:a@b.c", url));
+    BOOST_CHECK(!DecodeUrl("http://a b", url));
+    BOOST_CHECK(!DecodeUrl("  ", url));
+}
+
+BOOST_AUTO_TEST_CASE(tagSchemaTest)
+{
+    using namespace bbcpp;
+
+    // void tags take no content and no closing tag
+    auto doc = BBDocument::create();
+    doc->load("a[hr]b[BR][img=x.png]c[img]y.png[/img]");
+
+    const auto& children = doc->getChildren();
+    BOOST_REQUIRE_EQUAL(children.size(), 7u);
+    BOOST_CHECK(children[1]->downCast<BBElementPtr>()->isVoid());
+    BOOST_CHECK(children[1]->getChildren().empty());
+    BOOST_CHECK_EQUAL(children[2]->downCast<BBTextPtr>()->getText(), "b");
+    BOOST_CHECK(children[4]->downCast<BBElementPtr>()->isVoid());
+    BOOST_CHECK(!children[6]->downCast<BBElementPtr>()->isVoid());
+    BOOST_CHECK_EQUAL(children[6]->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(children[1]->getCloseTagSpan().begin, 5u);
+    BOOST_CHECK(children[1]->getContentSpan().empty());
+
+    // only an inline value makes [img] void, named parameters do not
+    doc = BBDocument::create();
+    doc->load("[img width=100]http://x/a.png[/img] after");
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    const auto image = doc->getChildren()[0]->downCast<BBElementPtr>();
+    BOOST_CHECK(!image->isVoid());
+    BOOST_CHECK_EQUAL(image->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[1]->downCast<BBTextPtr>()->getText(), " after");
+
+    // a list item ends at the next item, at the end of its list, or at the
+    // end of a nested list's item that was left open
+    doc = BBDocument::create();
+    doc->load("[list][*]a[b]b[*]c[list][*]d[/list][*]e[/list]f");
+
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    const auto& items = doc->getChildren()[0]->getChildren();
+    BOOST_REQUIRE_EQUAL(items.size(), 4u);
+    BOOST_CHECK_EQUAL(items[0]->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(items[0]->getChildren()[1]->getNodeName(), "b");
+    BOOST_CHECK_EQUAL(items[0]->getSourceSpan().end, 14u);
+    BOOST_CHECK_EQUAL(items[1]->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(items[1]->getChildren()[1]->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(items[2]->getChildren()[0]->downCast<BBTextPtr>()->getText(), "e");
+    BOOST_CHECK_EQUAL(items[3]->downCast<BBElementPtr>()->getElementType(), BBElement::CLOSING);
+    BOOST_CHECK_EQUAL(doc->getChildren()[1]->downCast<BBTextPtr>()->getText(), "f");
+
+    // outside of a list an item is text
+    doc = BBDocument::create();
+    doc->load("[*]x[b][*]");
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[0]->downCast<BBTextPtr>()->getText(), "[*]x");
+    BOOST_CHECK_EQUAL(doc->getChildren()[1]->getChildren()[0]->downCast<BBTextPtr>()->getText(), "[*]");
+
+    // without a schema every tag opens an element
+    ParseOptions options;
+    options.schema = nullptr;
+    doc = BBDocument::create();
+    doc->load("[hr]a[*]b", options);
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 1u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[0]->getChildren()[1]->getNodeName(), "*");
+
+    // and a custom schema applies to any tag name
+    auto schema = std::make_shared<BBTagSchema>();
+    schema->addVoidTag("smiley").addImplicitClose("td", "td").addParent("td", "tr");
+    options.schema = schema;
+    doc = BBDocument::create();
+    doc->load("[tr][td]a[Smiley]b[td]c[/tr]", options);
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 1u);
+    const auto& cells = doc->getChildren()[0]->getChildren();
+    BOOST_REQUIRE_EQUAL(cells.size(), 3u);
+    BOOST_CHECK_EQUAL(cells[0]->getChildren().size(), 3u);
+    BOOST_CHECK_EQUAL(cells[1]->getChildren().size(), 1u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
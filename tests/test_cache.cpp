@@ -0,0 +1,148 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../lib/BBRenderCache.h"
+
+BOOST_AUTO_TEST_SUITE(cache)
+
+BOOST_AUTO_TEST_CASE(hashTest)
+{
+    using namespace bbcpp;
+
+    BOOST_CHECK_EQUAL(BBRenderCache::hash("[b]x[/b]"), BBRenderCache::hash("[b]x[/b]"));
+    BOOST_CHECK_NE(BBRenderCache::hash("[b]x[/b]"), BBRenderCache::hash("[b]y[/b]"));
+    BOOST_CHECK_NE(BBRenderCache::hash("[b]x[/b]", 1), BBRenderCache::hash("[b]x[/b]", 2));
+    BOOST_CHECK_NE(BBRenderCache::hash(""), BBRenderCache::hash(std::string(1, '\0')));
+
+    // every length and every single byte change gives a new hash
+    std::set<std::uint64_t> hashes;
+    std::string text;
+    for (int n = 0; n < 64; n++)
+    {
+        text += static_cast<char>('a' + n % 26);
+        hashes.insert(BBRenderCache::hash(text));
+        for (std::size_t i = 0; i < text.size(); i++)
+        {
+            auto changed = text;
+            changed[i] ^= 1;
+            hashes.insert(BBRenderCache::hash(changed));
+        }
+    }
+    BOOST_CHECK_EQUAL(hashes.size(), 64u + 64u * 65u / 2u);
+}
+
+BOOST_AUTO_TEST_CASE(lruTest)
+{
+    using namespace bbcpp;
+
+    // one shard with room for three 36 byte outputs
+    BBRenderCache cache(3 * (36 + BBRenderCache::EntryOverhead), 1);
+    const std::string output(36, 'x');
+
+    cache.put(1, output);
+    cache.put(2, output);
+    cache.put(3, output);
+    BOOST_CHECK(cache.get(1));      // 1 is now the most recent
+
+    cache.put(4, output);           // evicts 2
+    BOOST_CHECK(!cache.get(2));
+    BOOST_CHECK(cache.get(1));
+    BOOST_CHECK(cache.get(3));
+    BOOST_CHECK_EQUAL(*cache.get(4), output);
+
+    auto stats = cache.getStats();
+    BOOST_CHECK_EQUAL(stats.hits, 4u);
+    BOOST_CHECK_EQUAL(stats.misses, 1u);
+    BOOST_CHECK_EQUAL(stats.insertions, 4u);
+    BOOST_CHECK_EQUAL(stats.evictions, 1u);
+    BOOST_CHECK_EQUAL(stats.entries, 3u);
+    BOOST_CHECK_EQUAL(stats.bytes, 3 * (36 + BBRenderCache::EntryOverhead));
+
+    // a larger output replaces the old one and makes room for itself
+    cache.put(4, std::string(100, 'y'));
+    BOOST_CHECK_EQUAL(cache.get(4)->size(), 100u);
+    BOOST_CHECK_LE(cache.getStats().bytes, cache.getCapacity());
+
+    // output over the capacity is not kept
+    cache.put(5, std::string(1000, 'z'));
+    BOOST_CHECK(!cache.get(5));
+
+    BOOST_CHECK(cache.erase(4));
+    BOOST_CHECK(!cache.erase(4));
+
+    cache.clear();
+    stats = cache.getStats();
+    BOOST_CHECK_EQUAL(stats.entries, 0u);
+    BOOST_CHECK_EQUAL(stats.bytes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(getOrRenderTest)
+{
+    using namespace bbcpp;
+
+    BBRenderCache cache(1 << 20);
+
+    int renders = 0;
+    const auto render = [&renders]()
+    {
+        renders++;
+        return std::string("<b>x</b>");
+    };
+
+    const auto key = BBRenderCache::hash("[b]x[/b]");
+    BOOST_CHECK_EQUAL(*cache.getOrRender(key, render), "<b>x</b>");
+    BOOST_CHECK_EQUAL(*cache.getOrRender(key, render), "<b>x</b>");
+    BOOST_CHECK_EQUAL(renders, 1);
+
+    // values stay valid after they are evicted
+    const auto value = cache.get(key);
+    cache.clear();
+    BOOST_CHECK_EQUAL(*value, "<b>x</b>");
+}
+
+BOOST_AUTO_TEST_CASE(concurrentTest)
+{
+    using namespace bbcpp;
+
+    // small enough that the threads keep evicting each other's entries
+    BBRenderCache cache(64 * 1024, 8);
+
+    std::atomic<int> wrong{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++)
+    {
+        threads.emplace_back([&cache, &wrong, t]()
+        {
+            for (int n = 0; n < 20000; n++)
+            {
+                const auto post = (n * 7 + t) % 500;
+                const auto expected = "post " + std::to_string(post);
+                const auto value = cache.getOrRender(BBRenderCache::hash(expected), [&expected]() { return expected; });
+                if (*value != expected)
+                {
+                    wrong++;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    const auto stats = cache.getStats();
+    BOOST_CHECK_EQUAL(wrong.load(), 0);
+    BOOST_CHECK_EQUAL(stats.hits + stats.misses, 8u * 20000u);
+    BOOST_CHECK_GT(stats.hits, 0u);
+    BOOST_CHECK_LE(stats.bytes, cache.getCapacity());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
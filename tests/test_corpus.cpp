@@ -0,0 +1,69 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "../lib/BBDocument.h"
+#include "../tools/BBCorpusGenerator.h"
+
+BOOST_AUTO_TEST_SUITE(corpus)
+
+BOOST_AUTO_TEST_CASE(reproducibleTest)
+{
+    using namespace bbcpp;
+
+    auto options = CorpusOptions::preset("mixed");
+    options.seed = 1234;
+    options.documents = 10;
+
+    const auto first = BBCorpusGenerator(options).generate();
+    const auto second = BBCorpusGenerator(options).generate();
+    BOOST_CHECK(first == second);
+
+    options.seed = 1235;
+    BOOST_CHECK(BBCorpusGenerator(options).generate() != first);
+}
+
+BOOST_AUTO_TEST_CASE(sizeDistributionTest)
+{
+    using namespace bbcpp;
+
+    auto options = CorpusOptions::preset("mixed");
+    options.documents = 50;
+    options.minSize = 100;
+    options.maxSize = 1000;
+    options.sizeDistribution = CorpusOptions::SizeDistribution::UNIFORM;
+
+    for (const auto& document : BBCorpusGenerator(options).generate())
+    {
+        // documents stop at the first word or tag that reaches the size, then close their open tags
+        BOOST_CHECK_GE(document.size(), 100u);
+        BOOST_CHECK_LT(document.size(), 1600u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(knobsTest)
+{
+    using namespace bbcpp;
+
+    auto text = CorpusOptions::preset("text");
+    text.quoteChainRate = 0.0;
+    auto doc = BBDocument::create();
+    doc->load(BBCorpusGenerator(text).nextDocument(2000));
+    BOOST_CHECK_EQUAL(doc->getStats().elementCount, 0u);
+
+    auto deep = CorpusOptions::preset("deep");
+    deep.quoteChainRate = 0.0;
+    doc = BBDocument::create();
+    doc->load(BBCorpusGenerator(deep).nextDocument(20000));
+    BOOST_CHECK_GT(doc->getStats().maxDepth, 4u);
+    BOOST_CHECK_LE(doc->getStats().maxDepth, deep.maxDepth);
+
+    auto quotes = CorpusOptions::preset("quotes");
+    doc = BBDocument::create();
+    doc->load(BBCorpusGenerator(quotes).nextDocument(100));
+    BOOST_CHECK_GT(doc->getStats().tagHistogram.at("quote"), 0u);
+
+    BOOST_CHECK_THROW(CorpusOptions::preset("nonsense"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,290 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../lib/BBDocument.h"
+#include "../lib/bbcpputils.h"
+
+namespace
+{
+
+// everything a load() produces: the tree with spans and the statistics
+std::string describe(const bbcpp::BBDocument& doc)
+{
+    using namespace bbcpp;
+
+    std::ostringstream out;
+    traverse(doc, [&out](const BBNode& node, std::size_t depth)
+    {
+        out << depth << ' ' << static_cast<int>(node.getNodeType()) << " '" << node.getNodeName() << "' "
+            << node.getSourceBegin() << '-' << node.getContentSpan().begin << '-'
+            << node.getContentSpan().end << '-' << node.getSourceEnd();
+        if (node.getNodeType() == BBNode::NodeType::ELEMENT)
+        {
+            const auto& element = static_cast<const BBElement&>(node);
+            out << " " << element.getElementType() << " " << element.getValue();
+            for (const auto& kv : element.getParameters())
+            {
+                out << ' ' << kv.first << '=' << kv.second;
+            }
+        }
+        out << '\n';
+        return VisitResult::CONTINUE;
+    });
+
+    const auto& stats = doc.getStats();
+    out << stats.elementCount << ' ' << stats.closingCount << ' ' << stats.textNodeCount << ' '
+        << stats.textLength << ' ' << stats.maxDepth << ' ' << doc.getSourceEnd();
+    for (const auto& entry : stats.tagHistogram)
+    {
+        out << ' ' << entry.first << ':' << entry.second;
+    }
+    return out.str();
+}
+
+std::string loaded(const std::string& bbcode)
+{
+    auto doc = bbcpp::BBDocument::create();
+    doc->load(bbcode);
+    return describe(*doc);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(edit)
+
+BOOST_AUTO_TEST_CASE(sourceSpanTest)
+{
+    using namespace bbcpp;
+
+    const std::string bbcode = "a[b]x[i]y[/i][/b][url=z]u";
+    auto doc = BBDocument::create();
+    doc->load(bbcode);
+    BOOST_CHECK_EQUAL(doc->getSource(), bbcode);
+
+    const auto span = [&bbcode](const BBNodePtr& node)
+    {
+        return bbcode.substr(node->getSourceBegin(), node->getSourceEnd() - node->getSourceBegin());
+    };
+
+    const auto& children = doc->getChildren();
+    BOOST_REQUIRE_EQUAL(children.size(), 3u);
+    BOOST_CHECK_EQUAL(span(children[0]), "a");
+    BOOST_CHECK_EQUAL(span(children[1]), "[b]x[i]y[/i][/b]");
+    BOOST_CHECK_EQUAL(span(children[1]->getChildren()[1]), "[i]y[/i]");
+    BOOST_CHECK_EQUAL(span(children[1]->getChildren()[2]), "[/b]");
+
+    // an unclosed element ends with the input
+    BOOST_CHECK_EQUAL(span(children[2]), "[url=z]u");
+}
+
+BOOST_AUTO_TEST_CASE(tagSpanTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("a[b]x[i]y[/i][/b][url=z]u");
+
+    const auto& children = doc->getChildren();
+    const auto bold = children[1];
+    BOOST_CHECK_EQUAL(doc->getSource(bold->getSourceSpan()), "[b]x[i]y[/i][/b]");
+    BOOST_CHECK_EQUAL(doc->getSource(bold->getOpenTagSpan()), "[b]");
+    BOOST_CHECK_EQUAL(doc->getSource(bold->getContentSpan()), "x[i]y[/i]");
+    BOOST_CHECK_EQUAL(doc->getSource(bold->getCloseTagSpan()), "[/b]");
+
+    // text is all content
+    const auto text = children[0];
+    BOOST_CHECK(text->getOpenTagSpan().empty());
+    BOOST_CHECK_EQUAL(doc->getSource(text->getContentSpan()), "a");
+    BOOST_CHECK(text->getCloseTagSpan().empty());
+
+    // a closing element is a tag of its own
+    const auto closer = bold->getChildren()[2];
+    BOOST_CHECK_EQUAL(doc->getSource(closer->getOpenTagSpan()), "[/b]");
+    BOOST_CHECK(closer->getContentSpan().empty());
+
+    // an unclosed element has no closing tag until one is loaded
+    const auto url = children[2];
+    BOOST_CHECK_EQUAL(doc->getSource(url->getOpenTagSpan()), "[url=z]");
+    BOOST_CHECK_EQUAL(doc->getSource(url->getContentSpan()), "u");
+    BOOST_CHECK(url->getCloseTagSpan().empty());
+
+    doc->load("rl[/url]");
+    BOOST_CHECK_EQUAL(doc->getSource(url->getContentSpan()), "url");
+    BOOST_CHECK_EQUAL(doc->getSource(url->getCloseTagSpan()), "[/url]");
+
+    // the document spans the whole source
+    BOOST_CHECK_EQUAL(doc->getSource(doc->getContentSpan()), doc->getSource());
+}
+
+BOOST_AUTO_TEST_CASE(incrementalTest)
+{
+    using namespace bbcpp;
+
+    std::string bbcode = "intro [quote]first [b]bold[/b] end[/quote] middle [i]x[/i] outro";
+    auto doc = BBDocument::create();
+    doc->load(bbcode);
+
+    // typing inside an element only touches that element
+    const auto quote = doc->getChildren()[1];
+    const auto outro = doc->getChildren().back();
+    BOOST_CHECK(doc->applyEdit(bbcode.find("bold"), 0, "very "));
+    bbcode.insert(bbcode.find("bold"), "very ");
+    BOOST_CHECK(doc->getChildren()[1] == quote);
+    BOOST_CHECK(doc->getChildren().back() == outro);
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+
+    // deleting top level text, and text that merges with its neighbours
+    BOOST_CHECK(doc->applyEdit(0, 6, ""));
+    bbcode.erase(0, 6);
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+
+    // new balanced markup
+    const auto middle = bbcode.find("middle");
+    BOOST_CHECK(doc->applyEdit(middle, 0, "[u]new[/u]"));
+    bbcode.insert(middle, "[u]new[/u]");
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+
+    // an opening tag inside a closed element changes what its closer closes
+    const auto end = bbcode.find(" end");
+    BOOST_CHECK(!doc->applyEdit(end, 0, "[s]"));
+    bbcode.insert(end, "[s]");
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+
+    // appending to the end, the live preview case
+    for (const char c : std::string(" and [b]more[/b"))
+    {
+        doc->applyEdit(bbcode.size(), 0, std::string(1, c));
+        bbcode += c;
+        BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+    }
+
+    BOOST_CHECK_THROW(doc->applyEdit(bbcode.size() + 1, 0, "x"), std::out_of_range);
+    BOOST_CHECK_THROW(doc->applyEdit(0, bbcode.size() + 1, ""), std::out_of_range);
+
+    // the same errors without exceptions, leaving the document alone
+    bool incremental = false;
+    BOOST_CHECK(doc->tryApplyEdit(bbcode.size() + 1, 0, "x", incremental) == BBStatus::OUT_OF_RANGE);
+    BOOST_CHECK(doc->tryApplyEdit(0, bbcode.size() + 1, "", incremental) == BBStatus::OUT_OF_RANGE);
+    BOOST_CHECK_EQUAL(doc->getSource(), bbcode);
+
+    BOOST_CHECK(doc->tryApplyEdit(0, 0, "x", incremental) == BBStatus::OK);
+    bbcode.insert(0, "x");
+    BOOST_CHECK(incremental);
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+}
+
+BOOST_AUTO_TEST_CASE(listEditTest)
+{
+    using namespace bbcpp;
+
+    std::string bbcode = "[list][*]a[*]b[hr]c[/list]";
+    auto doc = BBDocument::create();
+    doc->load(bbcode);
+
+    // removing an item lets the one before it run on
+    const auto second = bbcode.find("[*]b");
+    doc->applyEdit(second + 1, 1, "x");
+    bbcode.replace(second + 1, 1, "x");
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+
+    // and putting it back ends it again
+    doc->applyEdit(second + 1, 1, "*");
+    bbcode.replace(second + 1, 1, "*");
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+
+    // a new item inside an open one closes it
+    doc->applyEdit(bbcode.find("a"), 0, "[*]");
+    bbcode.insert(bbcode.find("a"), "[*]");
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+
+    // typing after a void tag does not go inside it
+    BOOST_CHECK(doc->applyEdit(bbcode.find("c"), 0, "z"));
+    bbcode.insert(bbcode.find("c"), "z");
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+}
+
+BOOST_AUTO_TEST_CASE(rawEditTest)
+{
+    using namespace bbcpp;
+
+    std::string bbcode = "a [code]x[b]y[/code] b";
+    auto doc = BBDocument::create();
+    doc->load(bbcode);
+
+    // typing inside raw content stays in its text node
+    const auto code = doc->getChildren()[1];
+    const auto inside = bbcode.find("y[");
+    BOOST_CHECK(doc->applyEdit(inside, 0, "[/b"));
+    bbcode.insert(inside, "[/b");
+    BOOST_CHECK(doc->getChildren()[1] == code);
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+
+    // a closing tag typed inside it ends the raw content early
+    BOOST_CHECK(!doc->applyEdit(inside, 0, "[/code]"));
+    bbcode.insert(inside, "[/code]");
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+
+    // breaking the opener turns the content back into tags
+    doc->applyEdit(bbcode.find("code"), 1, "");
+    bbcode.erase(bbcode.find("code"), 1);
+    BOOST_CHECK_EQUAL(describe(*doc), loaded(bbcode));
+}
+
+BOOST_AUTO_TEST_CASE(randomEditTest)
+{
+    using namespace bbcpp;
+
+    // short pieces that create and break tags in as many ways as possible
+    const std::string pieces[] = { "[", "]", "/", "b", "i", "x", " ", "=", "[b]", "[/b]", "[i]", "[/i]",
+        "[url=a]", "[/url]", "[quote user=x]", "[/quote]", "text", "[/", "[b", "\n" };
+
+    std::mt19937 random(7);
+    const auto piece = [&]() { return pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))]; };
+
+    for (int round = 0; round < 200; round++)
+    {
+        std::string bbcode;
+        for (int n = random() % 30; n > 0; n--)
+        {
+            bbcode += piece();
+        }
+
+        auto doc = BBDocument::create();
+        doc->load(bbcode);
+
+        for (int edit = 0; edit < 20; edit++)
+        {
+            const auto offset = random() % (bbcode.size() + 1);
+            const auto removed = std::min<std::size_t>(random() % 4, bbcode.size() - offset);
+            const auto inserted = random() % 3 == 0 ? std::string() : piece();
+
+            doc->applyEdit(offset, removed, inserted);
+            bbcode.replace(offset, removed, inserted);
+
+            BOOST_REQUIRE_EQUAL(describe(*doc), loaded(bbcode));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(limitsTest)
+{
+    using namespace bbcpp;
+
+    // documents loaded with limits are parsed again as a whole
+    ParseOptions options;
+    options.limits.maxDepth = 1;
+
+    auto doc = BBDocument::create();
+    doc->load("[b][i]x[/i][/b]", options);
+    BOOST_CHECK(!doc->applyEdit(7, 0, "y"));
+    BOOST_CHECK_EQUAL(doc->getSource(), "[b][i]xy[/i][/b]");
+    BOOST_CHECK_EQUAL(doc->getStats().degradedTags, 2u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[0]->getChildren()[0]->getNodeName(), "[i]xy[/i]");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,251 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../lib/BBDocument.h"
+#include "../lib/BBFrozenDocument.h"
+#include "../lib/bbcpputils.h"
+
+BOOST_AUTO_TEST_SUITE(frozen)
+
+BOOST_AUTO_TEST_CASE(structureTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("a[b]b[i]c[/i][/b][url=x]d[/url]");
+
+    const auto frozen = doc->freeze();
+    using Index = BBFrozenDocument::Index;
+
+    // #document, a, [b], b, [i], c, [/i], [/b], [url], d, [/url]
+    BOOST_REQUIRE_EQUAL(frozen->size(), 11u);
+    BOOST_CHECK(frozen->getNodeType(0) == BBNode::NodeType::DOCUMENT);
+    BOOST_CHECK_EQUAL(frozen->getParent(0), BBFrozenDocument::npos);
+    BOOST_CHECK_EQUAL(frozen->getEnd(0), 11u);
+    BOOST_CHECK_EQUAL(frozen->getChildCount(0), doc->getChildren().size());
+
+    // children of the document in order
+    std::vector<std::string> names;
+    for (Index node = frozen->getFirstChild(0); node != BBFrozenDocument::npos; node = frozen->getNextSibling(node))
+    {
+        names.emplace_back(frozen->getNodeName(node));
+        BOOST_CHECK_EQUAL(frozen->getParent(node), 0u);
+    }
+    BOOST_CHECK((names == std::vector<std::string>{ "a", "b", "url" }));
+
+    // [b] holds b, [i], c, [/i], [/b]
+    BOOST_CHECK(frozen->getNodeType(2) == BBNode::NodeType::ELEMENT);
+    BOOST_CHECK(frozen->getElementType(2) == BBElement::ElementType::SIMPLE);
+    BOOST_CHECK_EQUAL(frozen->getEnd(2), 8u);
+    BOOST_CHECK_EQUAL(frozen->getChildCount(2), 3u);
+    BOOST_CHECK_EQUAL(frozen->getNodeName(5), "c");
+    BOOST_CHECK_EQUAL(frozen->getParent(5), 4u);
+    BOOST_CHECK(frozen->getElementType(6) == BBElement::ElementType::CLOSING);
+
+    // text nodes have no children
+    BOOST_CHECK_EQUAL(frozen->getFirstChild(1), BBFrozenDocument::npos);
+
+    // an empty document is just the root
+    const auto empty = BBDocument::create()->freeze();
+    BOOST_CHECK_EQUAL(empty->size(), 1u);
+    BOOST_CHECK_EQUAL(empty->getFirstChild(0), BBFrozenDocument::npos);
+}
+
+BOOST_AUTO_TEST_CASE(parametersTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("[color=red]x[/color][quote user=Bob]y[/quote][b]z[/b]");
+
+    const auto frozen = doc->freeze();
+
+    std::string_view value;
+    BOOST_CHECK(frozen->getElementType(1) == BBElement::ElementType::VALUE);
+    BOOST_CHECK_EQUAL(frozen->getValue(1), "red");
+    BOOST_CHECK(!frozen->findParameter(1, "color", value));
+    BOOST_CHECK_EQUAL(frozen->getValue(4), "");
+
+    BOOST_REQUIRE_EQUAL(frozen->getParameterCount(4), 1u);
+    BOOST_CHECK(frozen->findParameter(4, "user", value));
+    BOOST_CHECK_EQUAL(value, "Bob");
+    BOOST_CHECK(!frozen->findParameter(4, "color", value));
+
+    BOOST_CHECK_EQUAL(frozen->getParameterCount(7), 0u);
+    BOOST_CHECK(!frozen->findParameter(7, "color", value));
+
+    // the copy does not depend on the source tree
+    doc.reset();
+    BOOST_CHECK_EQUAL(frozen->getNodeName(4), "quote");
+    BOOST_CHECK_EQUAL(frozen->getNodeName(7), "b");
+    BOOST_CHECK_EQUAL(frozen->getNodeName(8), "z");
+}
+
+BOOST_AUTO_TEST_CASE(concurrentReadersTest)
+{
+    using namespace bbcpp;
+
+    std::string bbcode;
+    for (int n = 0; n < 200; n++)
+    {
+        bbcode += "[quote user=x][b]bold[/b] text[i]" + std::to_string(n) + "[/i][/quote]";
+    }
+
+    auto doc = BBDocument::create();
+    doc->load(bbcode);
+    const auto frozen = doc->freeze();
+
+    std::size_t expected = 0;
+    for (std::size_t node = 0; node < frozen->size(); node++)
+    {
+        expected += frozen->getNodeName(static_cast<BBFrozenDocument::Index>(node)).size();
+    }
+
+    std::atomic<int> mismatches{ 0 };
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 8; t++)
+    {
+        readers.emplace_back([&frozen, &mismatches, expected]()
+        {
+            for (int pass = 0; pass < 50; pass++)
+            {
+                std::size_t length = 0;
+                for (std::size_t node = 0; node < frozen->size(); node++)
+                {
+                    length += frozen->getNodeName(static_cast<BBFrozenDocument::Index>(node)).size();
+                }
+                if (length != expected)
+                {
+                    mismatches++;
+                }
+            }
+        });
+    }
+
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    BOOST_CHECK_EQUAL(mismatches.load(), 0);
+}
+
+namespace
+{
+
+void checkSame(const bbcpp::BBFrozenDocument& expected, const bbcpp::BBFrozenDocument& actual)
+{
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    for (bbcpp::BBFrozenDocument::Index node = 0; node < expected.size(); node++)
+    {
+        BOOST_CHECK(actual.getNodeType(node) == expected.getNodeType(node));
+        BOOST_CHECK(actual.getElementType(node) == expected.getElementType(node));
+        BOOST_CHECK_EQUAL(actual.getNodeName(node), expected.getNodeName(node));
+        BOOST_CHECK_EQUAL(actual.getParent(node), expected.getParent(node));
+        BOOST_CHECK_EQUAL(actual.getNextSibling(node), expected.getNextSibling(node));
+        BOOST_CHECK_EQUAL(actual.getEnd(node), expected.getEnd(node));
+        BOOST_CHECK_EQUAL(actual.getChildCount(node), expected.getChildCount(node));
+        BOOST_REQUIRE_EQUAL(actual.getParameterCount(node), expected.getParameterCount(node));
+        for (std::size_t i = 0; i < expected.getParameterCount(node); i++)
+        {
+            BOOST_CHECK(actual.getParameter(node, i) == expected.getParameter(node, i));
+        }
+    }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(serializeTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("a[b]b[i]c[/i][/b][url=http://x.org]d[/url][quote user=Bob]e[/quote]");
+    const auto frozen = doc->freeze();
+
+    const auto buffer = doc->serialize();
+    BOOST_CHECK_EQUAL(buffer, frozen->serialize());
+    BOOST_CHECK_EQUAL(buffer.substr(0, 4), "BBCF");
+    BOOST_CHECK_GT(buffer.size(), BBFrozenDocument::HeaderSize
+        + frozen->size() * sizeof(BBFrozenDocument::Node) + 2 * sizeof(BBFrozenDocument::Parameter));
+
+    // std::string data is suitably aligned, so the tables are read in place
+    const auto view = BBFrozenDocument::deserialize(buffer.data(), buffer.size());
+    BOOST_CHECK(view->isView());
+    BOOST_CHECK(view->getNodeName(1).data() >= buffer.data()
+        && view->getNodeName(1).data() < buffer.data() + buffer.size());
+    checkSame(*frozen, *view);
+
+    // a misaligned buffer is decoded into a copy
+    std::string shifted = " " + buffer;
+    const auto copy = BBFrozenDocument::deserialize(shifted.data() + 1, buffer.size());
+    BOOST_CHECK(!copy->isView());
+    shifted.clear();
+    checkSame(*frozen, *copy);
+
+    // a round trip gives the same bytes, and an empty document works too
+    BOOST_CHECK_EQUAL(view->serialize(), buffer);
+    const auto empty = BBDocument::create()->serialize();
+    BOOST_CHECK_EQUAL(BBFrozenDocument::deserialize(empty.data(), empty.size())->size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(deserializeInvalidTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("[b]x[/b][color=red]y[/color]");
+    const auto buffer = doc->serialize();
+
+    const auto rejects = [](std::string bytes)
+    {
+        BOOST_CHECK_THROW(BBFrozenDocument::deserialize(bytes.data(), bytes.size()), std::invalid_argument);
+
+        BBFrozenDocumentPtr document;
+        BOOST_CHECK(BBFrozenDocument::tryDeserialize(bytes.data(), bytes.size(), document) == BBStatus::INVALID_FORMAT);
+        BOOST_CHECK(!document);
+    };
+
+    rejects("");
+    rejects(buffer.substr(0, BBFrozenDocument::HeaderSize - 1));
+    rejects(buffer.substr(0, buffer.size() - 1));
+    rejects(buffer + "x");
+
+    auto corrupt = buffer;
+    corrupt[0] = 'X';
+    rejects(corrupt);
+
+    corrupt = buffer;
+    corrupt[4] = 2;     // version
+    rejects(corrupt);
+
+    // the name of node 1 points past the strings
+    const auto node1 = BBFrozenDocument::HeaderSize + sizeof(BBFrozenDocument::Node);
+    corrupt = buffer;
+    corrupt[node1 + 23] = 0x7f;
+    rejects(corrupt);
+
+    // node 1 ends before it starts
+    corrupt = buffer;
+    corrupt.replace(node1 + 12, 4, std::string(4, '\0'));
+    rejects(corrupt);
+
+    // a sibling link that points backwards could loop forever
+    corrupt = buffer;
+    corrupt.replace(node1 + 8, 4, std::string("\x01\0\0\0", 4));
+    rejects(corrupt);
+
+    BOOST_CHECK_NO_THROW(BBFrozenDocument::deserialize(buffer.data(), buffer.size()));
+
+    BBFrozenDocumentPtr document;
+    BOOST_CHECK(BBFrozenDocument::tryDeserialize(buffer.data(), buffer.size(), document) == BBStatus::OK);
+    BOOST_REQUIRE(document);
+    BOOST_CHECK_EQUAL(document->size(), doc->freeze()->size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
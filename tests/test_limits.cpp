@@ -0,0 +1,162 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "../lib/BBDocument.h"
+#include "../lib/bbcpputils.h"
+#include "../lib/bbcpp_c.h"
+
+BOOST_AUTO_TEST_SUITE(limits)
+
+BOOST_AUTO_TEST_CASE(maxDepthTest)
+{
+    using namespace bbcpp;
+
+    ParseOptions options;
+    options.limits.maxDepth = 2;
+
+    auto doc = BBDocument::create();
+    doc->load("[b][i][u]x[/u][/i][/b]after", options);
+
+    // [u] and its closer stay text inside [i], [/i] and [/b] still close their own tags
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    const auto b = doc->getChildren()[0]->downCast<BBElementPtr>();
+    const auto i = b->getChildren()[0]->downCast<BBElementPtr>();
+    BOOST_CHECK_EQUAL(i->getNodeName(), "i");
+    BOOST_REQUIRE_EQUAL(i->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(i->getChildren()[0]->downCast<BBTextPtr>()->getText(), "[u]x[/u]");
+    BOOST_CHECK_EQUAL(doc->getChildren()[1]->downCast<BBTextPtr>()->getText(), "after");
+
+    BOOST_CHECK_EQUAL(doc->getStats().maxDepth, 2u);
+    BOOST_CHECK_EQUAL(doc->getStats().degradedTags, 2u);
+    BOOST_CHECK(!doc->getStats().truncated);
+
+    // only the closer of a refused tag is kept as text with it
+    options.limits.maxDepth = 1;
+    doc = BBDocument::create();
+    doc->load("[quote][b]x[/quote][i]y[/i][b]z[/b]", options);
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 3u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[0]->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[1]->getNodeName(), "i");
+    BOOST_CHECK_EQUAL(doc->getChildren()[2]->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getStats().degradedTags, 1u);
+
+    // a refused tag is forgotten when its parent closes
+    options.limits.maxDepth = 2;
+    doc = BBDocument::create();
+    doc->load("[quote][u][b][/u][b]x[/b][/b]y[/quote]", options);
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 1u);
+    const auto& quoted = doc->getChildren()[0]->getChildren();
+    BOOST_REQUIRE_EQUAL(quoted.size(), 4u);
+    BOOST_CHECK_EQUAL(quoted[1]->getNodeName(), "b");
+    BOOST_CHECK_EQUAL(quoted[2]->downCast<BBTextPtr>()->getText(), "[/b]y");
+
+    // 100k nested tags keep a bounded stack
+    std::string deep;
+    for (int n = 0; n < 100000; n++)
+    {
+        deep += "[b]";
+    }
+
+    options.limits.maxDepth = 64;
+    doc = BBDocument::create();
+    doc->load(deep, options);
+    BOOST_CHECK_EQUAL(doc->getStats().maxDepth, 64u);
+    BOOST_CHECK_EQUAL(doc->getStats().degradedTags, 100000u - 64u);
+    BOOST_CHECK_EQUAL(doc->getStats().textNodeCount, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(maxNodesTest)
+{
+    using namespace bbcpp;
+
+    ParseOptions options;
+    options.limits.maxNodes = 3;
+
+    auto doc = BBDocument::create();
+    doc->load("a[b]x[/b][i]y[/i]", options);
+
+    const auto& stats = doc->getStats();
+    BOOST_CHECK_EQUAL(stats.elementCount + stats.closingCount + stats.textNodeCount, 3u);
+    BOOST_CHECK(stats.truncated);
+    // the third node holds the rest of the input as text
+    BOOST_CHECK_EQUAL(getRawString(*doc), "ax[/b][i]y[/i]");
+
+    options.limits.maxNodes = 0;
+    doc = BBDocument::create();
+    doc->load("a[b]x", options);
+    BOOST_CHECK_EQUAL(doc->getChildren().size(), 0u);
+    BOOST_CHECK(doc->getStats().truncated);
+}
+
+BOOST_AUTO_TEST_CASE(maxTextLengthTest)
+{
+    using namespace bbcpp;
+
+    ParseOptions options;
+    options.limits.maxTextLength = 6;
+
+    auto doc = BBDocument::create();
+    doc->load("abc[b]defgh[/b]ijk", options);
+
+    BOOST_CHECK_EQUAL(doc->getStats().textLength, 6u);
+    BOOST_CHECK(doc->getStats().truncated);
+    BOOST_CHECK_EQUAL(getRawString(*doc), "abcdef");
+    BOOST_CHECK_EQUAL(doc->getStats().elementCount, 1u);
+    BOOST_CHECK_EQUAL(doc->getStats().closingCount, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(maxParametersAndNameTest)
+{
+    using namespace bbcpp;
+
+    ParseOptions options;
+    options.limits.maxParameters = 1;
+    options.limits.maxTagNameLength = 5;
+
+    auto doc = BBDocument::create();
+    doc->load("[color=red]a[/color][color=blue]b[/color][blockquote]c[/blockquote]", options);
+
+    const auto& stats = doc->getStats();
+    BOOST_CHECK_EQUAL(stats.elementCount, 1u);
+    BOOST_CHECK_EQUAL(stats.closingCount, 1u);
+    BOOST_CHECK_EQUAL(stats.degradedTags, 4u);
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[1]->downCast<BBTextPtr>()->getText(), "[color=blue]b[/color][blockquote]c[/blockquote]");
+
+    // an element of the refused tag opened after it takes the next closer
+    doc = BBDocument::create();
+    doc->load("[b a=1 c=2][b]x[/b][/b]y", options);
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 3u);
+    BOOST_CHECK_EQUAL(doc->getChildren()[1]->getNodeName(), "b");
+    BOOST_CHECK_EQUAL(doc->getChildren()[2]->downCast<BBTextPtr>()->getText(), "[/b]y");
+
+    // a refused name does not take the closer of another tag
+    doc = BBDocument::create();
+    doc->load("[b][verylongtag]x[/b]y", options);
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+    const auto bold = doc->getChildren()[0];
+    BOOST_REQUIRE_EQUAL(bold->getChildren().size(), 2u);
+    BOOST_CHECK_EQUAL(bold->getChildren()[0]->downCast<BBTextPtr>()->getText(), "[verylongtag]x");
+    BOOST_CHECK_EQUAL(doc->getChildren()[1]->downCast<BBTextPtr>()->getText(), "y");
+}
+
+BOOST_AUTO_TEST_CASE(cLimitsTest)
+{
+    bbcpp_document_handle doc = bbcpp_document_create();
+
+    bbcpp_parse_limits limits = {};
+    limits.max_depth = 1;
+    BOOST_REQUIRE_EQUAL(bbcpp_document_load_with_limits(doc, "[b][i]x[/i][/b]", &limits), BBCPP_SUCCESS);
+
+    bbcpp_document_stats stats;
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_stats(doc, &stats), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(stats.max_depth, 1u);
+    BOOST_CHECK_EQUAL(stats.degraded_tags, 2u);
+    BOOST_CHECK_EQUAL(stats.truncated, 0);
+
+    BOOST_CHECK_EQUAL(bbcpp_document_load_with_limits(doc, "x", nullptr), BBCPP_ERROR_NULL_POINTER);
+    bbcpp_document_destroy(doc);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,185 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include "../lib/BBDocument.h"
+#include "../tools/BBCorpusGenerator.h"
+
+// Times BBDocument::load() at sizes N, 2N, 4N and 8N and fails when the time
+// grows much faster than the input. A linear parser takes ~8x as long on the
+// largest input; quadratic behaviour takes ~64x, so the 16x limit leaves room
+// for cache effects and a noisy machine without letting a regression through.
+
+namespace
+{
+
+using InputMaker = std::function<std::string(std::size_t)>;
+
+constexpr std::size_t BaseSize = 32 * 1024;
+constexpr std::size_t Doublings = 3;
+constexpr double MaxGrowth = 16.0;
+
+std::string repeat(const std::string& prefix, const std::string& piece, std::size_t size)
+{
+    std::string text = prefix;
+    while (text.size() < size)
+    {
+        text += piece;
+    }
+    return text;
+}
+
+InputMaker repeated(const std::string& piece)
+{
+    return [piece](std::size_t size) { return repeat(std::string(), piece, size); };
+}
+
+InputMaker prefixed(const std::string& prefix, const std::string& piece)
+{
+    return [prefix, piece](std::size_t size) { return repeat(prefix, piece, size); };
+}
+
+InputMaker generated(const std::string& preset)
+{
+    return [preset](std::size_t size)
+    {
+        return bbcpp::BBCorpusGenerator(bbcpp::CorpusOptions::preset(preset)).nextDocument(size);
+    };
+}
+
+// seconds per load(), the best of several samples that each run for at
+// least a few milliseconds so short parses are not lost in timer noise
+double timeLoad(const std::string& text, const bbcpp::ParseOptions& options)
+{
+    using Clock = std::chrono::steady_clock;
+
+    double best = 0.0;
+    for (int sample = 0; sample < 3; sample++)
+    {
+        std::size_t iterations = 0;
+        const auto start = Clock::now();
+        auto elapsed = Clock::duration::zero();
+
+        do
+        {
+            auto doc = bbcpp::BBDocument::create();
+            doc->load(text, options);
+            iterations++;
+            elapsed = Clock::now() - start;
+        } while (elapsed < std::chrono::milliseconds(5));
+
+        const auto perLoad = std::chrono::duration<double>(elapsed).count() / static_cast<double>(iterations);
+        best = sample == 0 ? perLoad : std::min(best, perLoad);
+    }
+
+    return best;
+}
+
+double measureGrowth(const InputMaker& make, const bbcpp::ParseOptions& options)
+{
+    const auto first = timeLoad(make(BaseSize), options);
+    auto last = first;
+
+    for (std::size_t i = 1; i <= Doublings; i++)
+    {
+        last = timeLoad(make(BaseSize << i), options);
+    }
+
+    return last / first;
+}
+
+void checkLinear(const std::string& name, const InputMaker& make, const bbcpp::ParseOptions& options = {})
+{
+    auto growth = measureGrowth(make, options);
+    if (growth >= MaxGrowth)
+    {
+        // a busy machine can slow one size down; a real regression repeats
+        growth = std::min(growth, measureGrowth(make, options));
+    }
+
+    BOOST_TEST_MESSAGE(name << ": " << (1u << Doublings) << "x input took " << growth << "x as long");
+    BOOST_CHECK_MESSAGE(growth < MaxGrowth, name << " grew " << growth << "x for " << (1u << Doublings) << "x input");
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(scaling)
+
+BOOST_AUTO_TEST_CASE(brokenTagScalingTest)
+{
+    checkLinear("runs of [", repeated("["));
+    checkLinear("[b[b[b", repeated("[b"));
+    checkLinear("[/[/[/", repeated("[/"));
+    checkLinear("[b=[b=[b=", repeated("[b="));
+    checkLinear("late key/value failures", repeated("[a=b c=d e="));
+    checkLinear("late parameter failures", repeated("[quote user=a k=v k2=v2 "));
+}
+
+BOOST_AUTO_TEST_CASE(longTokenScalingTest)
+{
+    checkLinear("unterminated name", prefixed("[", "a"));
+    checkLinear("unterminated closing name", prefixed("[/", "a"));
+    checkLinear("unterminated value", prefixed("[a=", "b"));
+    checkLinear("unterminated pairs", prefixed("[a ", "b=c "));
+}
+
+BOOST_AUTO_TEST_CASE(nestingScalingTest)
+{
+    checkLinear("unclosed tags", repeated("[b]"));
+    checkLinear("unopened closing tags", repeated("[/b]"));
+    checkLinear("balanced tags", repeated("[b]x[/b]"));
+    checkLinear("unclosed parameter tags", repeated("[quote user=Bob]x"));
+
+    // a closer that matches nothing must not search the open elements
+    checkLinear("mismatched closing tags", repeated("[b][/i]"));
+    checkLinear("closing tags that unwind", repeated("[i][b][u][/i]"));
+    checkLinear("raw content", prefixed("[code]", "a[i] = [b]; [/cod"));
+    checkLinear("list items", prefixed("[list]", "[*]x[b][hr]"));
+    checkLinear("unterminated quoted value", prefixed("[q a=\"", "x y=\\\" "));
+}
+
+BOOST_AUTO_TEST_CASE(limitedScalingTest)
+{
+    bbcpp::ParseOptions options;
+    options.limits.maxDepth = 1;
+
+    // every tag inside [q] is refused; a closer that matches none of them
+    // must not search the refused tags
+    checkLinear("unmatched closers of refused tags", [](std::size_t size)
+    {
+        const auto count = size / 10;
+        std::string text = "[q]";
+        for (std::size_t i = 0; i < count; i++)
+        {
+            text += "[a][b]";
+        }
+        for (std::size_t i = 0; i < count; i++)
+        {
+            text += "[/c]";
+        }
+        return text;
+    }, options);
+    checkLinear("closers of refused tags", prefixed("[q]", "[a][b][/b][/a]"), options);
+}
+
+BOOST_AUTO_TEST_CASE(deepTeardownTest)
+{
+    // every unclosed tag nests one level deeper; freeing this must not recurse
+    auto doc = bbcpp::BBDocument::create();
+    doc->load(repeat(std::string(), "[b]", 3 * 500000));
+    BOOST_CHECK_EQUAL(doc->getStats().maxDepth, 500000u);
+    doc.reset();
+}
+
+BOOST_AUTO_TEST_CASE(generatedScalingTest)
+{
+    checkLinear("generated mixed", generated("mixed"));
+    checkLinear("generated deep", generated("deep"));
+    checkLinear("generated malformed", generated("malformed"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,375 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <string>
+
+#include "../lib/bbcpp_simple.h"
+
+BOOST_AUTO_TEST_SUITE(simple)
+
+BOOST_AUTO_TEST_CASE(extractUrlsTest)
+{
+    const std::string bbcode = "See [url=http://example.com]this[/url], [URL]www.test.org[/URL] and "
+                               "[img]http://x.org/a.png[/img] but not [url]unclosed";
+
+    bbcpp_span spans[4];
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_extract_url_spans(bbcode.c_str(), spans, 4), 3);
+    BOOST_CHECK_EQUAL(bbcode.substr(spans[0].offset, spans[0].length), "http://example.com");
+    BOOST_CHECK_EQUAL(bbcode.substr(spans[1].offset, spans[1].length), "www.test.org");
+    BOOST_CHECK_EQUAL(bbcode.substr(spans[2].offset, spans[2].length), "http://x.org/a.png");
+
+    // the count is reported even when there is no room for the spans
+    BOOST_CHECK_EQUAL(bbcpp_simple_extract_url_spans(bbcode.c_str(), nullptr, 0), 3);
+
+    // nothing inside [code] or [noparse] is a link
+    BOOST_CHECK_EQUAL(bbcpp_simple_extract_url_spans("[code][url=http://a.org]x[/url][/code][noparse][img]b.png[/img][/noparse]", nullptr, 0), 0);
+
+    // only [url=...] links to its value, the value of a named parameter is not a link
+    const std::string named = "[url=http://a.org]x[/url][url title=Hello]http://b.org[/url]";
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_extract_url_spans(named.c_str(), spans, 4), 2);
+    BOOST_CHECK_EQUAL(named.substr(spans[0].offset, spans[0].length), "http://a.org");
+    BOOST_CHECK_EQUAL(named.substr(spans[1].offset, spans[1].length), "http://b.org");
+
+    char urls[2][256];
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_extract_urls(bbcode.c_str(), urls, 2), 2);
+    BOOST_CHECK_EQUAL(std::string(urls[1]), "www.test.org");
+}
+
+BOOST_AUTO_TEST_CASE(stripTagTest)
+{
+    char output[128];
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_strip_tag("Hello [B]big [i]bold[/i][/b] world", "b", output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "Hello big [i]bold[/i] world");
+
+    // the content of [code] is kept as written
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_strip_tag("[b]a[/b][code]x[b]y[/b][/code]", "b", output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "a[code]x[b]y[/b][/code]");
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_strip_tag("[CODE]x[b]y[/code]z", "code", output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "x[b]yz");
+
+    // the output is truncated but always terminated
+    char small[6];
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_strip_tag("[b]Hello world[/b]", "b", small, sizeof(small)), 0);
+    BOOST_CHECK_EQUAL(std::string(small), "Hello");
+}
+
+BOOST_AUTO_TEST_CASE(replaceTagsTest)
+{
+    const bbcpp_tag_replacement replacements[] =
+    {
+        { "b", "<strong>", "</strong>" },
+        { "quote", "<blockquote>", "</blockquote>" }
+    };
+
+    char output[128];
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_replace_tags("[quote]a [b]b[/b] [u]c[/u][/QUOTE]", replacements, 2,
+                                                  output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "<blockquote>a <strong>b</strong> [u]c[/u]</blockquote>");
+
+    auto table = bbcpp_simple_compile_replacements(replacements, 2);
+    BOOST_REQUIRE(table != nullptr);
+    for (int i = 0; i < 2; i++)
+    {
+        BOOST_REQUIRE_EQUAL(bbcpp_simple_replace_tags_compiled("x[b]y[/b]", table, output, sizeof(output)), 0);
+        BOOST_CHECK_EQUAL(std::string(output), "x<strong>y</strong>");
+    }
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_replace_tags_compiled("[b]a[/b][noparse][b][/noparse]", table, output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "<strong>a</strong>[noparse][b][/noparse]");
+    bbcpp_simple_free_replacements(table);
+}
+
+BOOST_AUTO_TEST_CASE(countTagsTest)
+{
+    const char* bbcode = "[quote][b]a[/b][/quote] [b]b[/b] [url=http://x.org]c[/url]";
+    const char* names[] = { "b", "quote", "url", "img" };
+    int counts[4] = { -1, -1, -1, -1 };
+
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_count_tags_multi(bbcode, names, 4, counts), 0);
+    BOOST_CHECK_EQUAL(counts[0], 2);
+    BOOST_CHECK_EQUAL(counts[1], 1);
+    BOOST_CHECK_EQUAL(counts[2], 1);
+    BOOST_CHECK_EQUAL(counts[3], 0);
+
+    BOOST_CHECK_EQUAL(bbcpp_simple_count_tags(bbcode, "b"), 2);
+    BOOST_CHECK(bbcpp_simple_has_tag(bbcode, "quote"));
+    BOOST_CHECK(!bbcpp_simple_has_tag(bbcode, "img"));
+
+    // the raw tags themselves count, what is inside them does not
+    BOOST_CHECK_EQUAL(bbcpp_simple_count_tags("[code][b]x[/b][/code][b]y[/b]", "b"), 1);
+    BOOST_CHECK_EQUAL(bbcpp_simple_count_tags("[code][code]x[/code]", "code"), 1);
+}
+
+BOOST_AUTO_TEST_CASE(validateTest)
+{
+    bbcpp_validation_result result;
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate_ex("[b]a[I]b[/i][/B] [style color=red]c[/style]", &result), 1);
+    BOOST_CHECK_EQUAL(result.error, BBCPP_VALIDATION_OK);
+    BOOST_CHECK_EQUAL(result.unclosed_count, 0);
+
+    // [/b] skips the open [i], later tags are still checked
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate_ex("[b][i]x[/b][u]y[/u][/q]", &result), 0);
+    BOOST_CHECK_EQUAL(result.error, BBCPP_VALIDATION_MISMATCHED_CLOSE);
+    BOOST_CHECK_EQUAL(result.error_offset, 7u);
+    BOOST_CHECK_EQUAL(result.unclosed_count, 0);
+
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate_ex("x[/b]", &result), 0);
+    BOOST_CHECK_EQUAL(result.error, BBCPP_VALIDATION_UNEXPECTED_CLOSE);
+    BOOST_CHECK_EQUAL(result.error_offset, 1u);
+
+    // [bold] is not closed by [/b]
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate_ex("[quote][bold]x[/b]", &result), 0);
+    BOOST_CHECK_EQUAL(result.error, BBCPP_VALIDATION_UNEXPECTED_CLOSE);
+    BOOST_CHECK_EQUAL(result.unclosed_count, 2);
+    BOOST_CHECK_EQUAL(result.unclosed_offsets[0], 0u);
+    BOOST_CHECK_EQUAL(result.unclosed_offsets[1], 7u);
+
+    // deeper than the inline stack
+    std::string deep;
+    for (int i = 0; i < 200; i++) deep += "[b]";
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate_ex(deep.c_str(), &result), 0);
+    BOOST_CHECK_EQUAL(result.error, BBCPP_VALIDATION_UNCLOSED);
+    BOOST_CHECK_EQUAL(result.unclosed_count, 200);
+    BOOST_CHECK_EQUAL(result.error_offset, 597u);
+
+    // tags inside [code] are text, an unclosed [code] runs to the end
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate_ex("[code]a[b]c[/code]", &result), 1);
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate_ex("[code]a[/b]", &result), 0);
+    BOOST_CHECK_EQUAL(result.error, BBCPP_VALIDATION_UNCLOSED);
+    BOOST_CHECK_EQUAL(result.unclosed_count, 1);
+
+    // [img=url] is void, [img width=100] needs its closing tag like load() does
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate_ex("[img=a.png][img width=100]b.png[/img]", &result), 1);
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate_ex("[img width=100]b.png", &result), 0);
+    BOOST_CHECK_EQUAL(result.error, BBCPP_VALIDATION_UNCLOSED);
+
+    char message[64];
+    BOOST_CHECK_EQUAL(bbcpp_simple_validate("[b]unclosed tag", message, sizeof(message)), 0);
+    BOOST_CHECK_EQUAL(std::string(message), "Unclosed tag at offset 0");
+}
+
+BOOST_AUTO_TEST_CASE(getTextTest)
+{
+    char output[2048];
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_text("a[b]b[i]c[/i][/b]d", output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "abcd");
+
+    // text nodes longer than any fixed scratch buffer are kept
+    const std::string longText(1500, 'x');
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_text(("[b]" + longText + "[/b]").c_str(), output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), longText);
+
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_text("abcdef", output, 4), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "abc");
+
+    std::string deep;
+    for (int i = 0; i < 100000; i++) deep += "[b]";
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_text((deep + "end").c_str(), output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "end");
+}
+
+BOOST_AUTO_TEST_CASE(toHtmlTest)
+{
+    char output[256];
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_to_html("a[b]x[i]y[/i][/b]z[/b][quote]q[/quote]", output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "a<strong>x<em>y</em></strong>z[/b]<blockquote>q</blockquote>");
+
+    // tags are written whole or not at all
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_to_html("a[b]x[/b]", output, 8), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "ax");
+
+    // tag names are matched in any case
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_to_html("[B]x[/b][Quote]q[/QUOTE]", output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "<strong>x</strong><blockquote>q</blockquote>");
+
+    // nothing inside [code] is a tag
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_to_html("[code][b]x[/b][/code]", output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "<code>[b]x[/b]</code>");
+}
+
+BOOST_AUTO_TEST_CASE(renderCacheTest)
+{
+    auto cache = bbcpp_render_cache_create(1 << 20, 0);
+    BOOST_REQUIRE(cache);
+
+    const char* bbcode = "a[b]x[i]y[/i][/b]z";
+    char output[256];
+    char cached[256];
+
+    // the same input is cached once per renderer and comes back unchanged
+    for (int n = 0; n < 3; n++)
+    {
+        BOOST_REQUIRE_EQUAL(bbcpp_simple_to_html_cached(cache, bbcode, cached, sizeof(cached)), 0);
+        BOOST_CHECK_EQUAL(std::string(cached), "a<strong>x<em>y</em></strong>z");
+        BOOST_REQUIRE_EQUAL(bbcpp_simple_get_text_cached(cache, bbcode, cached, sizeof(cached)), 0);
+        BOOST_CHECK_EQUAL(std::string(cached), "axyz");
+    }
+
+    bbcpp_render_cache_stats stats;
+    BOOST_REQUIRE_EQUAL(bbcpp_render_cache_get_stats(cache, &stats), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(stats.misses, 2u);
+    BOOST_CHECK_EQUAL(stats.hits, 4u);
+    BOOST_CHECK_EQUAL(stats.entries, 2u);
+
+    // truncated output is not stored, so a larger buffer still gets all of it
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_to_html_cached(cache, "[b]long text[/b]", output, 8), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "long te");
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_to_html_cached(cache, "[b]long text[/b]", output, sizeof(output)), 0);
+    BOOST_CHECK_EQUAL(std::string(output), "<strong>long text</strong>");
+
+    // a hit that does not fit the buffer is truncated like an uncached render
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_text_cached(cache, bbcode, cached, 3), 0);
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_text(bbcode, output, 3), 0);
+    BOOST_CHECK_EQUAL(std::string(cached), std::string(output));
+
+    // the raw interface
+    const auto key = bbcpp_render_cache_key("input", 5, 99);
+    size_t length = 0;
+    BOOST_CHECK_EQUAL(bbcpp_render_cache_get(cache, key, output, sizeof(output), &length), BBCPP_ERROR_NOT_FOUND);
+    BOOST_CHECK_EQUAL(bbcpp_render_cache_put(cache, key, "rendered", 8), BBCPP_SUCCESS);
+    BOOST_REQUIRE_EQUAL(bbcpp_render_cache_get(cache, key, output, sizeof(output), &length), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(std::string(output, length), "rendered");
+
+    BOOST_CHECK_EQUAL(bbcpp_render_cache_clear(cache), BBCPP_SUCCESS);
+    BOOST_REQUIRE_EQUAL(bbcpp_render_cache_get_stats(cache, &stats), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(stats.entries, 0u);
+
+    // without a cache the functions render every time
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_to_html_cached(nullptr, bbcode, cached, sizeof(cached)), 0);
+    BOOST_CHECK_EQUAL(std::string(cached), "a<strong>x<em>y</em></strong>z");
+
+    bbcpp_render_cache_destroy(cache);
+}
+
+namespace
+{
+
+struct TraverseLog
+{
+    std::string events;
+    std::size_t maxDepth = 0;
+};
+
+bbcpp_visit_result logVisit(bbcpp_node_handle node, bbcpp_visit_event event, size_t depth, void* user_data)
+{
+    auto log = static_cast<TraverseLog*>(user_data);
+
+    char name[64];
+    size_t length;
+    bbcpp_node_get_name(node, name, sizeof(name), &length);
+    log->events += (event == BBCPP_VISIT_ENTER ? "<" : ">") + std::string(name);
+    log->maxDepth = std::max(log->maxDepth, depth);
+
+    return std::string(name) == "skip" && event == BBCPP_VISIT_ENTER ? BBCPP_VISIT_SKIP_CHILDREN : BBCPP_VISIT_CONTINUE;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(documentTraverseTest)
+{
+    bbcpp_document_handle doc = bbcpp_document_create();
+    BOOST_REQUIRE_EQUAL(bbcpp_document_load(doc, "a[b]x[/b][skip]y[/skip]"), BBCPP_SUCCESS);
+
+    TraverseLog log;
+    BOOST_REQUIRE_EQUAL(bbcpp_document_traverse(doc, logVisit, &log), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(log.events, "<a>a<b<x>x<b>b>b<skip>skip");
+    BOOST_CHECK_EQUAL(log.maxDepth, 1u);
+
+    bbcpp_node_handle child;
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_child(doc, 1, &child), BBCPP_SUCCESS);
+    log = TraverseLog();
+    BOOST_REQUIRE_EQUAL(bbcpp_node_traverse(child, logVisit, &log), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(log.events, "<x>x<b>b");
+    bbcpp_node_destroy(child);
+
+    BOOST_CHECK_EQUAL(bbcpp_document_traverse(doc, nullptr, nullptr), BBCPP_ERROR_NULL_POINTER);
+    bbcpp_document_destroy(doc);
+}
+
+BOOST_AUTO_TEST_CASE(sourceSpansTest)
+{
+    bbcpp_document_handle doc = bbcpp_document_create();
+    BOOST_REQUIRE_EQUAL(bbcpp_document_load(doc, "a[b]x[/b]"), BBCPP_SUCCESS);
+
+    const char* source = nullptr;
+    size_t length = 0;
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_source(doc, &source, &length), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(std::string(source, length), "a[b]x[/b]");
+
+    bbcpp_node_handle bold;
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_child(doc, 1, &bold), BBCPP_SUCCESS);
+
+    bbcpp_span open, content, close;
+    BOOST_REQUIRE_EQUAL(bbcpp_node_get_source_spans(bold, &open, &content, &close), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(std::string(source + open.offset, open.length), "[b]");
+    BOOST_CHECK_EQUAL(std::string(source + content.offset, content.length), "x");
+    BOOST_CHECK_EQUAL(std::string(source + close.offset, close.length), "[/b]");
+
+    BOOST_CHECK_EQUAL(bbcpp_node_get_source_spans(bold, nullptr, &content, nullptr), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(bbcpp_node_get_source_spans(nullptr, &open, &content, &close), BBCPP_ERROR_NULL_POINTER);
+
+    bbcpp_node_destroy(bold);
+    bbcpp_document_destroy(doc);
+}
+
+BOOST_AUTO_TEST_CASE(elementValueTest)
+{
+    bbcpp_document_handle doc = bbcpp_document_create();
+    BOOST_REQUIRE_EQUAL(bbcpp_document_load(doc, "[quote=Bob;1234]x[/quote][b]y[/b]"), BBCPP_SUCCESS);
+
+    bbcpp_node_handle quote, bold;
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_child(doc, 0, &quote), BBCPP_SUCCESS);
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_child(doc, 1, &bold), BBCPP_SUCCESS);
+
+    bbcpp_element_type type;
+    BOOST_REQUIRE_EQUAL(bbcpp_element_get_type(quote, &type), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(type, BBCPP_ELEMENT_VALUE);
+
+    char buffer[16];
+    size_t length = 0;
+    BOOST_REQUIRE_EQUAL(bbcpp_element_get_value(quote, buffer, sizeof(buffer), &length), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(std::string(buffer), "Bob;1234");
+    BOOST_REQUIRE_EQUAL(bbcpp_element_get_value_field(quote, 1, buffer, sizeof(buffer), &length), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(std::string(buffer), "1234");
+    BOOST_CHECK_EQUAL(length, 4u);
+    BOOST_CHECK_EQUAL(bbcpp_element_get_value_field(quote, 2, buffer, sizeof(buffer), &length), BBCPP_ERROR_NOT_FOUND);
+    BOOST_CHECK_EQUAL(bbcpp_element_get_value(bold, buffer, sizeof(buffer), &length), BBCPP_ERROR_NOT_FOUND);
+
+    bbcpp_node_destroy(quote);
+    bbcpp_node_destroy(bold);
+    bbcpp_document_destroy(doc);
+}
+
+BOOST_AUTO_TEST_CASE(elementTypedValueTest)
+{
+    bbcpp_document_handle doc = bbcpp_document_create();
+    BOOST_REQUIRE_EQUAL(bbcpp_document_load(doc, "[color=#00ff00]x[/color][quote=Bob;42]y[/quote][url=https://x.org]z[/url]"), BBCPP_SUCCESS);
+
+    bbcpp_node_handle color, quote, link;
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_child(doc, 0, &color), BBCPP_SUCCESS);
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_child(doc, 1, &quote), BBCPP_SUCCESS);
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_child(doc, 2, &link), BBCPP_SUCCESS);
+
+    uint32_t rgba = 0;
+    BOOST_REQUIRE_EQUAL(bbcpp_element_get_color(color, &rgba), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(rgba, 0x00ff00ffu);
+    BOOST_CHECK_EQUAL(bbcpp_element_get_color(quote, &rgba), BBCPP_ERROR_NOT_FOUND);
+
+    int64_t post = 0;
+    BOOST_REQUIRE_EQUAL(bbcpp_element_get_integer(quote, &post), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(post, 42);
+
+    const char* url = NULL;
+    size_t length = 0;
+    BOOST_REQUIRE_EQUAL(bbcpp_element_get_url(link, &url, &length), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(std::string(url, length), "https://x.org");
+    BOOST_CHECK_EQUAL(bbcpp_element_get_url(link, NULL, &length), BBCPP_ERROR_NULL_POINTER);
+
+    bbcpp_node_destroy(color);
+    bbcpp_node_destroy(quote);
+    bbcpp_node_destroy(link);
+    bbcpp_document_destroy(doc);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,155 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "../lib/BBDocument.h"
+#include "../lib/bbcpp_simple.h"
+
+BOOST_AUTO_TEST_SUITE(stats)
+
+BOOST_AUTO_TEST_CASE(documentStatsTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("Hello [b]bold [i]both[/i][/b] and [b]more[/b] [style color=red]x");
+
+    const auto& stats = doc->getStats();
+    BOOST_CHECK_EQUAL(stats.elementCount, 4u);
+    BOOST_CHECK_EQUAL(stats.closingCount, 3u);
+    BOOST_CHECK_EQUAL(stats.textNodeCount, 7u);
+    BOOST_CHECK_EQUAL(stats.textLength, std::string("Hello bold both and more x").size());
+    BOOST_CHECK_EQUAL(stats.maxDepth, 2u);
+    BOOST_CHECK_EQUAL(stats.tagHistogram.size(), 3u);
+    BOOST_CHECK_EQUAL(stats.tagHistogram.at("b"), 2u);
+    BOOST_CHECK_EQUAL(stats.tagHistogram.at("style"), 1u);
+
+    // tags are counted by name in any case
+    doc = BBDocument::create();
+    doc->load("[B]x[/B][b]y[/b][Quote]z[/Quote][Spoiler]s[/spoiler][SPOILER]t[/SPOILER]");
+    BOOST_CHECK_EQUAL(doc->getStats().tagHistogram.size(), 3u);
+    BOOST_CHECK_EQUAL(doc->getStats().tagHistogram.at("b"), 2u);
+    BOOST_CHECK_EQUAL(doc->getStats().tagHistogram.at("quote"), 1u);
+    BOOST_CHECK_EQUAL(doc->getStats().tagHistogram.at("spoiler"), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(mergedTextStatsTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("This is[text[[[");
+
+    BOOST_CHECK_EQUAL(doc->getChildren().size(), 1u);
+    BOOST_CHECK_EQUAL(doc->getStats().textNodeCount, 1u);
+    BOOST_CHECK_EQUAL(doc->getStats().textLength, 15u);
+    BOOST_CHECK_EQUAL(doc->getStats().elementCount, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(parseMetricsTest)
+{
+    using namespace bbcpp;
+
+    const std::string bbcode = "Hello [b]bold[b[i]x[/i][/b] [quote user=Bob]y";
+
+    ParseMetrics metrics;
+    auto doc = BBDocument::create();
+    doc->load(bbcode, metrics);
+
+    BOOST_CHECK_EQUAL(metrics.bytesScanned, bbcode.size());
+    BOOST_CHECK_EQUAL(metrics.elementNodes, 3u);
+    BOOST_CHECK_EQUAL(metrics.closingNodes, 2u);
+    BOOST_CHECK_EQUAL(metrics.failedTags, 1u);
+    BOOST_CHECK_EQUAL(metrics.textMerges, 1u);
+    BOOST_CHECK_EQUAL(metrics.textNodes, doc->getStats().textNodeCount);
+    BOOST_CHECK_EQUAL(metrics.maxDepth, 2u);
+    BOOST_CHECK_GE(metrics.allocations, metrics.textNodes + metrics.elementNodes + metrics.closingNodes);
+
+    // metrics describe the latest load only
+    doc->load("plain", metrics);
+    BOOST_CHECK_EQUAL(metrics.bytesScanned, 5u);
+    BOOST_CHECK_EQUAL(metrics.elementNodes, 0u);
+    BOOST_CHECK_EQUAL(metrics.failedTags, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(parseTraceTest)
+{
+    using namespace bbcpp;
+
+    NullParseMetrics metrics;
+    ParseTrace trace;
+    auto doc = BBDocument::create();
+    doc->load("a[b]x[/b][style color=red]y[/style][i", metrics, trace);
+
+    // nine tokens ("[i" is split into "[" and "i") plus the call that finds the end
+    BOOST_CHECK_EQUAL(trace.count(ParsePhase::TOKENIZE), 10u);
+    BOOST_CHECK_EQUAL(trace.count(ParsePhase::PARAMETERS), 1u);
+    BOOST_CHECK_EQUAL(trace.count(ParsePhase::NODES), 7u);
+    BOOST_CHECK_EQUAL(trace.count(ParsePhase::FIXUP), 2u);
+    BOOST_CHECK_EQUAL(trace.events().size(), 20u);
+    BOOST_CHECK_EQUAL(trace.droppedEvents(), 0u);
+
+    std::ostringstream json;
+    trace.writeChromeTrace(json);
+    BOOST_CHECK(json.str().find("\"traceEvents\"") != std::string::npos);
+    BOOST_CHECK(json.str().find("\"name\":\"parameters\"") != std::string::npos);
+
+    ParseTrace capped(4);
+    doc = BBDocument::create();
+    doc->load("a[b]x[/b][style color=red]y[/style][i", metrics, capped);
+    BOOST_CHECK_EQUAL(capped.events().size(), 4u);
+    BOOST_CHECK_EQUAL(capped.droppedEvents(), 16u);
+    BOOST_CHECK_EQUAL(capped.count(ParsePhase::TOKENIZE), 10u);
+}
+
+BOOST_AUTO_TEST_CASE(simpleStatsTest)
+{
+    bbcpp_stats stats;
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_stats("a[b]b[i]c[/i][/b][b]d[/b]", &stats), 0);
+    BOOST_CHECK_EQUAL(stats.total_tags, 3);
+    BOOST_CHECK_EQUAL(stats.text_nodes, 4);
+    BOOST_CHECK_EQUAL(stats.unique_tags, 2);
+    BOOST_CHECK_EQUAL(stats.max_nesting_depth, 2);
+    BOOST_CHECK_EQUAL(stats.total_text_length, 4u);
+
+    bbcpp_tag_count entries[4];
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_tag_histogram("a[b]b[i]c[/i][/b][b]d[/b]", entries, 4), 2);
+    BOOST_CHECK_EQUAL(std::string(entries[0].tag_name), "b");
+    BOOST_CHECK_EQUAL(entries[0].count, 2);
+    BOOST_CHECK_EQUAL(std::string(entries[1].tag_name), "i");
+    BOOST_CHECK_EQUAL(entries[1].count, 1);
+
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_stats("[B]x[/B][b]y[/b][Quote]z[/Quote]", &stats), 0);
+    BOOST_CHECK_EQUAL(stats.unique_tags, 2);
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_tag_histogram("[B]x[/B][b]y[/b][Quote]z[/Quote]", entries, 4), 2);
+    BOOST_CHECK_EQUAL(std::string(entries[0].tag_name), "b");
+    BOOST_CHECK_EQUAL(entries[0].count, 2);
+
+    // the count is reported even when only some entries fit
+    BOOST_REQUIRE_EQUAL(bbcpp_simple_get_tag_histogram("[i]x[/i][b]y[/b][u]z[/u]", entries, 1), 3);
+    BOOST_CHECK_EQUAL(std::string(entries[0].tag_name), "b");
+    BOOST_CHECK_EQUAL(bbcpp_simple_get_tag_histogram("[i]x[/i][b]y[/b][u]z[/u]", nullptr, 0), 3);
+}
+
+BOOST_AUTO_TEST_CASE(documentHistogramTest)
+{
+    bbcpp_document_handle doc = bbcpp_document_create();
+    BOOST_REQUIRE_EQUAL(bbcpp_document_load(doc, "[U]a[/U][b]b[/b][u]c[/u]"), BBCPP_SUCCESS);
+
+    bbcpp_tag_histogram_entry entries[4];
+    size_t count = 0;
+    BOOST_REQUIRE_EQUAL(bbcpp_document_get_tag_histogram(doc, entries, 4, &count), BBCPP_SUCCESS);
+    BOOST_REQUIRE_EQUAL(count, 2u);
+    BOOST_CHECK_EQUAL(std::string(entries[0].name, entries[0].name_length), "b");
+    BOOST_CHECK_EQUAL(entries[0].count, 1u);
+    BOOST_CHECK_EQUAL(std::string(entries[1].name), "u");
+    BOOST_CHECK_EQUAL(entries[1].count, 2u);
+
+    BOOST_CHECK_EQUAL(bbcpp_document_get_tag_histogram(doc, nullptr, 0, &count), BBCPP_SUCCESS);
+    BOOST_CHECK_EQUAL(count, 2u);
+    BOOST_CHECK_EQUAL(bbcpp_document_get_tag_histogram(doc, nullptr, 1, &count), BBCPP_ERROR_NULL_POINTER);
+
+    bbcpp_document_destroy(doc);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,261 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "../lib/BBDocument.h"
+
+BOOST_AUTO_TEST_SUITE(tokenizer)
+
+using namespace bbcpp;
+
+std::vector<BBToken> tokenize(std::string_view text, bool strictAttributes = false)
+{
+    std::vector<BBToken> tokens;
+    BBTokenizer tokenizer(text, strictAttributes);
+    BBToken token;
+
+    while (tokenizer.next(token))
+    {
+        tokens.push_back(token);
+    }
+
+    return tokens;
+}
+
+BOOST_AUTO_TEST_CASE(elementTokensTest)
+{
+    const auto tokens = tokenize("This is [b]bold[/b] and [style color=red]red[/style]");
+    BOOST_REQUIRE_EQUAL(tokens.size(), 8u);
+
+    BOOST_CHECK(tokens[0].type == BBToken::Type::TEXT);
+    BOOST_CHECK_EQUAL(tokens[0].source, "This is ");
+
+    BOOST_CHECK(tokens[1].type == BBToken::Type::ELEMENT);
+    BOOST_CHECK_EQUAL(tokens[1].source, "[b]");
+    BOOST_CHECK_EQUAL(tokens[1].name, "b");
+    BOOST_CHECK(!tokens[1].hasParameter());
+
+    BOOST_CHECK(tokens[3].type == BBToken::Type::CLOSING);
+    BOOST_CHECK_EQUAL(tokens[3].name, "b");
+
+    BOOST_CHECK(tokens[5].type == BBToken::Type::ELEMENT);
+    BOOST_CHECK_EQUAL(tokens[5].name, "style");
+    BOOST_CHECK_EQUAL(tokens[5].key, "color");
+    BOOST_CHECK_EQUAL(tokens[5].value, "red");
+
+    BOOST_CHECK_EQUAL(tokens[7].source, "[/style]");
+}
+
+BOOST_AUTO_TEST_CASE(brokenTokensTest)
+{
+    // tags that fail to parse come back as text and the token sources
+    // always cover the whole input
+    for (const std::string text : { "This is[text[[[[[[", "This is[b[b]", "[color=]x", "[/", "[a=b c=d e=",
+        "[q a=\"x", "[q a=\"x[b]\"]", "[q a='x\\'] b" })
+    {
+        std::string joined;
+        for (const auto& token : tokenize(text))
+        {
+            joined.append(token.source);
+        }
+        BOOST_CHECK_EQUAL(joined, text);
+    }
+
+    // a buffer ending inside a tag is not read past its end
+    for (const std::string text : { "x[*", "x[/*", "x[" })
+    {
+        const std::vector<char> buffer(text.begin(), text.end());
+        std::string joined;
+        BBTokenizer tokenizer(buffer.data(), buffer.data() + buffer.size());
+        BBToken token;
+        while (tokenizer.next(token))
+        {
+            BOOST_CHECK(token.type == BBToken::Type::TEXT);
+            joined.append(token.source);
+        }
+        BOOST_CHECK_EQUAL(joined, text);
+    }
+
+    const auto tokens = tokenize("This is[b[b]");
+    BOOST_REQUIRE_EQUAL(tokens.size(), 3u);
+    BOOST_CHECK(tokens[1].type == BBToken::Type::TEXT);
+    BOOST_CHECK_EQUAL(tokens[1].source, "[b");
+    BOOST_CHECK(tokens[2].type == BBToken::Type::ELEMENT);
+}
+
+BOOST_AUTO_TEST_CASE(attributesTest)
+{
+    const auto pairs = [](const BBToken& token)
+    {
+        std::string result;
+        BBAttributeLexer attributes(token.attributes);
+        for (std::string_view key, value; attributes.next(key, value);)
+        {
+            result.append(key).append("=").append(UnescapeValue(value)).append(";");
+        }
+        return result;
+    };
+
+    // quoted values, spaces around '=' and several pairs
+    auto tokens = tokenize("[quote name=\"John Smith\" post=5]x[/quote][style color = 'dark red' ]");
+    BOOST_REQUIRE_EQUAL(tokens.size(), 4u);
+    BOOST_CHECK(tokens[0].type == BBToken::Type::ELEMENT);
+    BOOST_CHECK_EQUAL(tokens[0].key, "name");
+    BOOST_CHECK_EQUAL(tokens[0].value, "John Smith");
+    BOOST_CHECK_EQUAL(tokens[0].parameterCount, 2u);
+    BOOST_CHECK_EQUAL(pairs(tokens[0]), "name=John Smith;post=5;");
+    BOOST_CHECK(tokens[3].type == BBToken::Type::ELEMENT);
+    BOOST_CHECK_EQUAL(pairs(tokens[3]), "color=dark red;");
+
+    // escaped quotes stay escaped in the view
+    tokens = tokenize("[quote name=\"John \\\"JJ\\\" Smith\"][quote = \"a;b\"]");
+    BOOST_REQUIRE_EQUAL(tokens.size(), 2u);
+    BOOST_CHECK_EQUAL(tokens[0].value, "John \\\"JJ\\\" Smith");
+    BOOST_CHECK_EQUAL(UnescapeValue(tokens[0].value), "John \"JJ\" Smith");
+    BOOST_CHECK(tokens[1].hasValue());
+    BOOST_CHECK_EQUAL(tokens[1].value, "a;b");
+
+    // pairs need a space between them and quoted values cannot hold a '['
+    for (const std::string text : { "[q a=\"1\"b=2]", "[q a=\"[b]\"]", "[q a=\"x]", "[q = ]", "[/q=1]" })
+    {
+        BOOST_CHECK_MESSAGE(tokenize(text)[0].type == BBToken::Type::TEXT, text);
+    }
+
+    // an unquoted value holds anything up to a space or the bracket
+    tokens = tokenize("[q a=1b=2][url=http://x/?a=b&c=%20#top]");
+    BOOST_REQUIRE_EQUAL(tokens.size(), 2u);
+    BOOST_CHECK_EQUAL(pairs(tokens[0]), "a=1b=2;");
+    BOOST_CHECK(tokens[1].hasValue());
+    BOOST_CHECK_EQUAL(tokens[1].value, "http://x/?a=b&c=%20#top");
+
+    // the strict grammar takes one unquoted pair with nothing around the '='
+    BOOST_CHECK(tokenize("[style color=red]", true)[0].type == BBToken::Type::ELEMENT);
+    BOOST_CHECK(tokenize("[color=red]", true)[0].hasValue());
+    for (const std::string text : { "[style color =red]", "[style color=red ]", "[q a=1 b=2]", "[q a=\"x\"]", "[color = red]" })
+    {
+        BOOST_CHECK_MESSAGE(tokenize(text, true)[0].type == BBToken::Type::TEXT, text);
+        BOOST_CHECK_MESSAGE(tokenize(text)[0].type == BBToken::Type::ELEMENT, text);
+    }
+
+    // a document reads every pair, and the strict option keeps them as text
+    auto doc = BBDocument::create();
+    doc->load("[quote name=\"John Smith\" post=5]x[/quote]");
+    const auto quote = doc->getChildren()[0]->downCast<BBElementPtr>();
+    BOOST_CHECK_EQUAL(quote->getParameter("name"), "John Smith");
+    BOOST_CHECK_EQUAL(quote->getParameter("post"), "5");
+
+    ParseOptions options;
+    options.strictAttributes = true;
+    doc = BBDocument::create();
+    doc->load("[quote name=\"John Smith\" post=5]x[/quote]", options);
+    BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 1u);
+    BOOST_CHECK(doc->getChildren()[0]->getNodeType() == BBNode::NodeType::TEXT);
+}
+
+BOOST_AUTO_TEST_CASE(spacedParameterTest)
+{
+    // the cases left commented out in simpletests.cpp
+    for (const std::string text : {
+        "This is [style color=red]WARNING[/style]",
+        "This is [style color =red]red[/color]",
+        "This is [style color= red]red[/color]",
+        "This is [style color = red]red[/color]",
+        "This is [style color=red ]red[/color]" })
+    {
+        BOOST_TEST_CONTEXT(text)
+        {
+            auto doc = BBDocument::create();
+            doc->load(text);
+            BOOST_REQUIRE_EQUAL(doc->getChildren().size(), 2u);
+
+            const auto style = doc->getChildren()[1]->downCast<BBElementPtr>(false);
+            BOOST_REQUIRE(style);
+            BOOST_CHECK_EQUAL(style->getParameters().size(), 1u);
+            BOOST_CHECK_EQUAL(style->getParameter("color"), "red");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(loadTest)
+{
+    auto doc = BBDocument::create();
+    doc->load("This is[b[b]text[/b] [color=red]x");
+
+    const auto& children = doc->getChildren();
+    BOOST_REQUIRE_EQUAL(children.size(), 4u);
+    BOOST_CHECK_EQUAL(children[0]->downCast<BBTextPtr>()->getText(), "This is[b");
+    BOOST_CHECK_EQUAL(children[1]->getNodeName(), "b");
+    BOOST_CHECK_EQUAL(children[2]->downCast<BBTextPtr>()->getText(), " ");
+
+    const auto color = children[3]->downCast<BBElementPtr>();
+    BOOST_CHECK(color->getElementType() == BBElement::VALUE);
+    BOOST_CHECK_EQUAL(color->getValue(), "red");
+    BOOST_CHECK(color->getParameters().empty());
+}
+
+BOOST_AUTO_TEST_CASE(tagTableTest)
+{
+    BBTagTable table;
+    BOOST_CHECK_EQUAL(table.find("b"), BBTagTable::npos);
+
+    for (int i = 0; i < 100; i++)
+    {
+        BOOST_CHECK_EQUAL(table.intern("tag" + std::to_string(i)), static_cast<std::size_t>(i));
+    }
+
+    BOOST_CHECK_EQUAL(table.intern("TAG7"), 7u);
+    BOOST_CHECK_EQUAL(table.find("Tag42"), 42u);
+    BOOST_CHECK_EQUAL(table.find("tag100"), BBTagTable::npos);
+    BOOST_CHECK_EQUAL(table.getName(3), "tag3");
+}
+
+BOOST_AUTO_TEST_CASE(findClosingTagTest)
+{
+    const std::string text = "a[/cod][code][/code x][/CoDe][/code]";
+    const auto begin = text.data();
+    const auto end = begin + text.size();
+
+    BOOST_CHECK_EQUAL(BBTokenizer::findClosingTag(begin, end, "code") - begin, 22);
+    BOOST_CHECK(BBTokenizer::findClosingTag(begin, end - 8, "code") == nullptr);
+    BOOST_CHECK(BBTokenizer::findClosingTag(begin, end, "noparse") == nullptr);
+    BOOST_CHECK(BBTokenizer::findClosingTag(begin, begin + 2, "b") == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(tagIdTest)
+{
+    const auto tokens = tokenize("[QUOTE][Quote=x][/quote][Style a=b][/B][bold]");
+    BOOST_REQUIRE_EQUAL(tokens.size(), 6u);
+    BOOST_CHECK_EQUAL(tokens[0].tagId, BBTag::QUOTE);
+    BOOST_CHECK_EQUAL(tokens[1].tagId, BBTag::QUOTE);
+    BOOST_CHECK_EQUAL(tokens[2].tagId, BBTag::QUOTE);
+    BOOST_CHECK_EQUAL(tokens[3].tagId, BBTag::NONE);
+    BOOST_CHECK_EQUAL(tokens[4].tagId, BBTag::B);
+    BOOST_CHECK_EQUAL(tokens[5].tagId, BBTag::NONE);
+    BOOST_CHECK_EQUAL(tokenize("text")[0].tagId, BBTag::NONE);
+
+    // other names are numbered by the document, keeping their first spelling
+    auto doc = BBDocument::create();
+    doc->load("[B]x[/b][Spoiler]y[/SPOILER][note]z");
+
+    const auto& children = doc->getChildren();
+    const auto bold = children[0]->downCast<BBElementPtr>();
+    BOOST_CHECK_EQUAL(bold->getNodeName(), "B");
+    BOOST_CHECK_EQUAL(bold->getTagId(), BBTag::B);
+
+    const auto spoiler = children[1]->downCast<BBElementPtr>();
+    const auto spoilerCloser = spoiler->getChildren().back()->downCast<BBElementPtr>();
+    BOOST_CHECK_EQUAL(spoiler->getTagId(), BBTag::COUNT);
+    BOOST_CHECK_EQUAL(spoilerCloser->getTagId(), spoiler->getTagId());
+    BOOST_CHECK_EQUAL(children[2]->downCast<BBElementPtr>()->getTagId(), BBTag::COUNT + 1);
+
+    BOOST_CHECK_EQUAL(doc->getTagId("spoiler"), BBTag::COUNT);
+    BOOST_CHECK_EQUAL(doc->getTagId("Url"), BBTag::URL);
+    BOOST_CHECK_EQUAL(doc->getTagId("missing"), BBTag::NONE);
+    BOOST_CHECK_EQUAL(doc->getTagName(BBTag::COUNT), "Spoiler");
+    BOOST_CHECK_EQUAL(doc->getTagName(BBTag::COLOR), "color");
+
+    // elements made outside a document know the common tags
+    BOOST_CHECK_EQUAL(BBElement("Img").getTagId(), BBTag::IMG);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
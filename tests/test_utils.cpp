@@ -15,4 +15,77 @@ BOOST_AUTO_TEST_CASE(nodeTypeStringTest)
     BOOST_CHECK(nodeTypeToString(BBNode::NodeType::TEXT) == "Text");
 }
 
+BOOST_AUTO_TEST_CASE(countTagsTest)
+{
+    using namespace bbcpp;
+
+    const auto counts = countTags("[b]a[/b] [B]b[/B] [i]c[/i] [color=red]d[/color] [b", { "b", "i", "u", "color", "B" });
+    BOOST_REQUIRE_EQUAL(counts.size(), 5u);
+    BOOST_CHECK_EQUAL(counts[0], 2u);
+    BOOST_CHECK_EQUAL(counts[1], 1u);
+    BOOST_CHECK_EQUAL(counts[2], 0u);
+    BOOST_CHECK_EQUAL(counts[3], 1u);
+    BOOST_CHECK_EQUAL(counts[4], 2u);
+}
+
+BOOST_AUTO_TEST_CASE(traverseTest)
+{
+    using namespace bbcpp;
+
+    auto doc = BBDocument::create();
+    doc->load("a[b]x[i]y[/i][/b]z");
+
+    std::string order;
+    traverse(*doc,
+        [&order](const BBNode& node, std::size_t depth)
+        {
+            order += "<" + node.getNodeName() + std::to_string(depth);
+            return VisitResult::CONTINUE;
+        },
+        [&order](const BBNode& node, std::size_t)
+        {
+            order += ">" + node.getNodeName();
+            return VisitResult::CONTINUE;
+        });
+    BOOST_CHECK_EQUAL(order, "<a0>a<b0<x1>x<i1<y2>y<i2>i>i<b1>b>b<z0>z");
+
+    // skipping children still leaves the node, stopping ends the walk
+    std::string visited;
+    const auto finished = traverse(*doc, [&visited](const BBNode& node, std::size_t)
+    {
+        visited += node.getNodeName();
+        if (node.getNodeName() == "b") return VisitResult::SKIP_CHILDREN;
+        if (node.getNodeName() == "z") return VisitResult::STOP;
+        return VisitResult::CONTINUE;
+    });
+    BOOST_CHECK(!finished);
+    BOOST_CHECK_EQUAL(visited, "abz");
+
+    BOOST_CHECK_EQUAL(getRawString(*doc), "axyz");
+}
+
+BOOST_AUTO_TEST_CASE(deepTraverseTest)
+{
+    using namespace bbcpp;
+
+    std::string bbcode;
+    for (int i = 0; i < 200000; i++)
+    {
+        bbcode += "[b]";
+    }
+    bbcode += "deep";
+
+    auto doc = BBDocument::create();
+    doc->load(bbcode);
+
+    std::size_t maxDepth = 0;
+    traverse(*doc, [&maxDepth](const BBNode&, std::size_t depth)
+    {
+        maxDepth = std::max(maxDepth, depth);
+        return VisitResult::CONTINUE;
+    });
+    BOOST_CHECK_EQUAL(maxDepth, 200000u);
+    BOOST_CHECK_EQUAL(getRawString(*doc), "deep");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "BBCorpusGenerator.h"
+
+namespace bbcpp
+{
+
+namespace
+{
+
+const char* const Words[] =
+{
+    "the", "of", "and", "to", "in", "is", "it", "that", "was", "for", "on", "are", "with", "as", "they",
+    "be", "at", "one", "have", "this", "from", "or", "had", "by", "word", "but", "what", "some", "we",
+    "can", "out", "other", "were", "all", "there", "when", "up", "use", "your", "how", "said", "each",
+    "which", "their", "time", "will", "way", "about", "many", "then", "them", "would", "like", "so",
+    "thread", "forum", "post", "reply", "quote", "server", "build", "release", "patch", "update"
+};
+
+const char* const Tags[] = { "b", "i", "u", "s", "quote", "code", "url", "color", "size", "list" };
+
+const char* const Users[] = { "Alice", "Bob", "carol99", "DaveR", "eve", "Mallory", "Trent", "peggy" };
+
+const char* const Colors[] = { "red", "blue", "green", "#ff8800", "#00aaff" };
+
+template<typename T, std::size_t N>
+constexpr std::size_t countOf(const T (&)[N])
+{
+    return N;
+}
+
+}
+
+CorpusOptions CorpusOptions::preset(const std::string& name)
+{
+    CorpusOptions options;
+
+    if (name == "mixed")
+    {
+        // the defaults resemble an ordinary forum
+    }
+    else if (name == "text")
+    {
+        options.tagRatio = 0.0;
+        options.quoteChainRate = 0.0;
+    }
+    else if (name == "deep")
+    {
+        options.tagRatio = 0.6;
+        options.maxDepth = 32;
+    }
+    else if (name == "parameters")
+    {
+        options.tagRatio = 0.4;
+        options.parameterDensity = 0.9;
+    }
+    else if (name == "quotes")
+    {
+        options.quoteChainRate = 1.0;
+        options.maxQuoteChain = 12;
+    }
+    else if (name == "malformed")
+    {
+        options.tagRatio = 0.4;
+        options.malformedRate = 0.5;
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown corpus preset '" + name + "'");
+    }
+
+    return options;
+}
+
+BBCorpusGenerator::BBCorpusGenerator(const CorpusOptions& options)
+    : _options(options), _state(options.seed)
+{
+    // nothing to do
+}
+
+std::uint64_t BBCorpusGenerator::nextRandom()
+{
+    // splitmix64
+    std::uint64_t z = (_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+std::size_t BBCorpusGenerator::nextIndex(std::size_t count)
+{
+    return static_cast<std::size_t>(nextRandom() % count);
+}
+
+double BBCorpusGenerator::nextUnit()
+{
+    return static_cast<double>(nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+bool BBCorpusGenerator::chance(double probability)
+{
+    return nextUnit() < probability;
+}
+
+std::size_t BBCorpusGenerator::nextSize()
+{
+    const auto minSize = _options.minSize;
+    const auto maxSize = std::max(_options.minSize, _options.maxSize);
+
+    switch (_options.sizeDistribution)
+    {
+        default:
+        case CorpusOptions::SizeDistribution::FIXED:
+            return minSize;
+
+        case CorpusOptions::SizeDistribution::UNIFORM:
+            return minSize + nextIndex(maxSize - minSize + 1);
+
+        case CorpusOptions::SizeDistribution::PARETO:
+        {
+            // shape 1.5, clamped to the requested range
+            const auto size = static_cast<double>(minSize) / std::pow(1.0 - nextUnit(), 1.0 / 1.5);
+            return std::min(maxSize, static_cast<std::size_t>(size));
+        }
+    }
+}
+
+void BBCorpusGenerator::appendWords(std::string& text, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        text += Words[nextIndex(countOf(Words))];
+        text += ' ';
+    }
+}
+
+void BBCorpusGenerator::appendOpenTag(std::string& text, const std::string& name)
+{
+    text += '[';
+    text += name;
+
+    if (chance(_options.parameterDensity))
+    {
+        if (name == "quote")
+        {
+            text += " user=";
+            text += Users[nextIndex(countOf(Users))];
+        }
+        else if (name == "url")
+        {
+            text += "=http://www.example.com/";
+            text += Words[nextIndex(countOf(Words))];
+        }
+        else if (name == "size")
+        {
+            text += '=';
+            text += std::to_string(1 + nextIndex(7));
+        }
+        else
+        {
+            text += (name == "color" ? "=" : " color=");
+            text += Colors[nextIndex(countOf(Colors))];
+        }
+    }
+
+    text += ']';
+}
+
+void BBCorpusGenerator::appendMalformedTag(std::string& text)
+{
+    const std::string name = Tags[nextIndex(countOf(Tags))];
+
+    switch (nextIndex(6))
+    {
+        case 0: text += "[" + name + " "; break;                    // never closed
+        case 1: text += "[" + name + "["; break;                    // bracket inside the name
+        case 2: text += "[/" + name + " "; break;                   // broken closing tag
+        case 3: text += "[" + name + "=a b=c d="; break;            // pairs that fail late
+        case 4: text += "[quote=" + std::string(Users[nextIndex(countOf(Users))]) + ";1234]"; break;
+        default: text += "[[["; break;
+    }
+}
+
+void BBCorpusGenerator::appendQuoteChain(std::string& text)
+{
+    const auto length = 1 + nextIndex(std::max<std::size_t>(1, _options.maxQuoteChain));
+
+    for (std::size_t i = 0; i < length; i++)
+    {
+        text += "[quote user=";
+        text += Users[nextIndex(countOf(Users))];
+        text += ']';
+        appendWords(text, 3 + nextIndex(12));
+    }
+
+    for (std::size_t i = 0; i < length; i++)
+    {
+        text += "[/quote]\n";
+    }
+}
+
+std::string BBCorpusGenerator::nextDocument()
+{
+    return nextDocument(nextSize());
+}
+
+std::string BBCorpusGenerator::nextDocument(std::size_t size)
+{
+    std::string text;
+    text.reserve(size + 64);
+
+    if (chance(_options.quoteChainRate))
+    {
+        appendQuoteChain(text);
+    }
+
+    std::vector<std::string> open;
+
+    while (text.size() < size)
+    {
+        if (!chance(_options.tagRatio))
+        {
+            appendWords(text, 1);
+        }
+        else if (chance(_options.malformedRate))
+        {
+            appendMalformedTag(text);
+        }
+        else if (!open.empty() && (open.size() >= _options.maxDepth || chance(0.5)))
+        {
+            text += "[/" + open.back() + "]";
+            open.pop_back();
+        }
+        else if (_options.maxDepth == 0)
+        {
+            appendWords(text, 1);
+        }
+        else
+        {
+            open.emplace_back(Tags[nextIndex(countOf(Tags))]);
+            appendOpenTag(text, open.back());
+        }
+    }
+
+    while (!open.empty())
+    {
+        text += "[/" + open.back() + "]";
+        open.pop_back();
+    }
+
+    return text;
+}
+
+std::vector<std::string> BBCorpusGenerator::generate()
+{
+    std::vector<std::string> documents;
+    documents.reserve(_options.documents);
+
+    for (std::size_t i = 0; i < _options.documents; i++)
+    {
+        documents.push_back(nextDocument());
+    }
+
+    return documents;
+}
+
+std::string BBCorpusGenerator::generateText()
+{
+    std::string text;
+
+    for (const auto& document : generate())
+    {
+        text += document;
+        text += "\n\n";
+    }
+
+    return text;
+}
+
+} // namespace
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bbcpp
+{
+
+// Knobs for synthetic BBCode. Every probability is in [0, 1].
+struct CorpusOptions
+{
+    enum class SizeDistribution
+    {
+        FIXED,      // every document is `minSize` bytes
+        UNIFORM,    // sizes spread evenly between `minSize` and `maxSize`
+        PARETO      // mostly short posts with a long tail up to `maxSize`
+    };
+
+    std::uint64_t       seed = 1;
+    std::size_t         documents = 100;
+    std::size_t         minSize = 256;
+    std::size_t         maxSize = 4096;
+    SizeDistribution    sizeDistribution = SizeDistribution::PARETO;
+
+    double              tagRatio = 0.2;         // chance that the next item is a tag rather than a word
+    std::size_t         maxDepth = 4;           // deepest nesting of generated elements
+    double              parameterDensity = 0.2; // chance that an opening tag carries a parameter
+    double              quoteChainRate = 0.2;   // chance that a document opens with a chain of quotes
+    std::size_t         maxQuoteChain = 3;      // longest quote chain
+    double              malformedRate = 0.0;    // chance that a tag is broken in some way
+
+    // named profiles: "mixed", "text", "deep", "parameters", "quotes", "malformed"
+    static CorpusOptions preset(const std::string& name);
+};
+
+// Writes reproducible BBCode: the same options and seed always produce the
+// same bytes on every platform, since no standard distributions are used.
+class BBCorpusGenerator
+{
+public:
+    explicit BBCorpusGenerator(const CorpusOptions& options);
+
+    // the next document, sized according to the size distribution
+    std::string nextDocument();
+
+    // the next document with roughly `size` bytes
+    std::string nextDocument(std::size_t size);
+
+    // `options.documents` documents
+    std::vector<std::string> generate();
+
+    // all documents joined by blank lines, as one corpus
+    std::string generateText();
+
+private:
+    CorpusOptions       _options;
+    std::uint64_t       _state;
+
+    std::uint64_t nextRandom();
+    std::size_t nextIndex(std::size_t count);
+    double nextUnit();
+    bool chance(double probability);
+
+    std::size_t nextSize();
+    void appendWords(std::string& text, std::size_t count);
+    void appendOpenTag(std::string& text, const std::string& name);
+    void appendMalformedTag(std::string& text);
+    void appendQuoteChain(std::string& text);
+};
+
+} // namespace
@@ -0,0 +1,104 @@
+#include <fstream>
+#include <iostream>
+
+#include "../examples/cxxopts.hpp"
+#include "BBCorpusGenerator.h"
+
+using namespace bbcpp;
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options(argv[0], " - generates reproducible BBCode corpora");
+
+    options.add_options()
+        ("p, preset", "Preset: mixed, text, deep, parameters, quotes, malformed", cxxopts::value<std::string>()->default_value("mixed"))
+        ("s, seed", "Random seed", cxxopts::value<std::uint64_t>())
+        ("n, documents", "Number of documents", cxxopts::value<std::size_t>())
+        ("min-size", "Smallest document in bytes", cxxopts::value<std::size_t>())
+        ("max-size", "Largest document in bytes", cxxopts::value<std::size_t>())
+        ("distribution", "Size distribution: fixed, uniform, pareto", cxxopts::value<std::string>())
+        ("tag-ratio", "Chance that an item is a tag", cxxopts::value<double>())
+        ("max-depth", "Deepest element nesting", cxxopts::value<std::size_t>())
+        ("parameter-density", "Chance that a tag carries a parameter", cxxopts::value<double>())
+        ("quote-chain-rate", "Chance that a document opens with nested quotes", cxxopts::value<double>())
+        ("max-quote-chain", "Longest quote chain", cxxopts::value<std::size_t>())
+        ("malformed-rate", "Chance that a tag is broken", cxxopts::value<double>())
+        ("o, output", "Output file, standard output when omitted", cxxopts::value<std::string>())
+        ("h, help", "Print help");
+
+    try
+    {
+        cxxopts::ParseResult result = options.parse(argc, argv);
+
+        if (result.count("help") > 0)
+        {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+
+        auto corpus = CorpusOptions::preset(result["preset"].as<std::string>());
+
+        if (result.count("seed") > 0) corpus.seed = result["seed"].as<std::uint64_t>();
+        if (result.count("documents") > 0) corpus.documents = result["documents"].as<std::size_t>();
+        if (result.count("min-size") > 0) corpus.minSize = result["min-size"].as<std::size_t>();
+        if (result.count("max-size") > 0) corpus.maxSize = result["max-size"].as<std::size_t>();
+        if (result.count("tag-ratio") > 0) corpus.tagRatio = result["tag-ratio"].as<double>();
+        if (result.count("max-depth") > 0) corpus.maxDepth = result["max-depth"].as<std::size_t>();
+        if (result.count("parameter-density") > 0) corpus.parameterDensity = result["parameter-density"].as<double>();
+        if (result.count("quote-chain-rate") > 0) corpus.quoteChainRate = result["quote-chain-rate"].as<double>();
+        if (result.count("max-quote-chain") > 0) corpus.maxQuoteChain = result["max-quote-chain"].as<std::size_t>();
+        if (result.count("malformed-rate") > 0) corpus.malformedRate = result["malformed-rate"].as<double>();
+
+        if (result.count("distribution") > 0)
+        {
+            const auto distribution = result["distribution"].as<std::string>();
+            if (distribution == "fixed")
+            {
+                corpus.sizeDistribution = CorpusOptions::SizeDistribution::FIXED;
+            }
+            else if (distribution == "uniform")
+            {
+                corpus.sizeDistribution = CorpusOptions::SizeDistribution::UNIFORM;
+            }
+            else if (distribution == "pareto")
+            {
+                corpus.sizeDistribution = CorpusOptions::SizeDistribution::PARETO;
+            }
+            else
+            {
+                std::cerr << "unknown distribution: " << distribution << std::endl;
+                return 1;
+            }
+        }
+
+        const auto text = BBCorpusGenerator(corpus).generateText();
+
+        if (result.count("output") > 0)
+        {
+            const auto filename = result["output"].as<std::string>();
+            std::ofstream file(filename, std::ios::binary);
+            if (!file.good())
+            {
+                std::cerr << "cannot write: " << filename << std::endl;
+                return 1;
+            }
+            file << text;
+        }
+        else
+        {
+            std::cout << text;
+        }
+    }
+    catch (const cxxopts::OptionException& e)
+    {
+        std::cerr << "error parsing options: " << e.what() << std::endl;
+        return 1;
+    }
+    catch (const std::invalid_argument& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}